@@ -0,0 +1,114 @@
+/*
+ * lockbench.c
+ *
+ * Hammers one gtthreads spinlock from a uthread on each of `lwp_count`
+ * kthreads and reports the throughput, for comparing the spinlock
+ * implementations (see gtthreads/gt_spinlock.h). `make compare` runs it for
+ * each of them on 1 to 64 kthreads.
+ *
+ * usage: lockbench [lwp_count [iterations]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gt_thread.h>
+#include <gt_spinlock.h>
+
+#define DEFAULT_LWP_COUNT 4
+#define DEFAULT_ITERATIONS 200000
+/* cache lines written inside the critical section */
+#define SHARED_LINES 4
+/* pauses between two acquisitions */
+#define THINK_TIME 64
+
+typedef struct bench_arg {
+	long iterations;
+	long acquired;
+} bench_arg_t;
+
+static gt_spinlock_t bench_lock = GT_SPINLOCK_NAMED_INITIALIZER("bench_lock");
+static volatile long shared[SHARED_LINES * 8];
+static volatile int started = 0;
+static int lwp_count;
+
+static int hammer(void *p)
+{
+	bench_arg_t *arg = p;
+
+	/* start together, or the first kthreads up run uncontended */
+	__sync_add_and_fetch(&started, 1);
+	while (started < lwp_count)
+		__asm__ __volatile__ ("pause\n");
+
+	for (long i = 0; i < arg->iterations; i++) {
+		gt_spin_lock(&bench_lock);
+		for (int l = 0; l < SHARED_LINES; l++)
+			shared[l * 8]++;
+		gt_spin_unlock(&bench_lock);
+		arg->acquired++;
+		for (int t = 0; t < THINK_TIME; t++)
+			__asm__ __volatile__ ("pause\n");
+	}
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	lwp_count = argc > 1 ? atoi(argv[1]) : DEFAULT_LWP_COUNT;
+	long iterations = argc > 2 ? atol(argv[2]) : DEFAULT_ITERATIONS;
+	if (lwp_count < 1 || iterations < 1) {
+		fprintf(stderr, "usage: %s [lwp_count [iterations]]\n",
+		        argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (strcmp(gt_spinlock_name, GT_SPINLOCK_NAME)) {
+		fprintf(stderr, "built for %s spinlocks, but libgtthreads has "
+		        "%s\n", GT_SPINLOCK_NAME, gt_spinlock_name);
+		return EXIT_FAILURE;
+	}
+
+	bench_arg_t *args = calloc(lwp_count, sizeof(*args));
+	if (!args) {
+		fprintf(stderr, "Malloc failure");
+		return EXIT_FAILURE;
+	}
+
+	gtthread_options_t opt;
+	gtthread_options_init(&opt);
+	opt.scheduler_type = SCHEDULER_PCS; /* spreads uthreads round robin */
+	opt.lwp_count = lwp_count;
+	gtthread_app_init(&opt);
+
+	double start = now();
+	uthread_tid tid;
+	for (int i = 0; i < lwp_count; i++) {
+		args[i].iterations = iterations;
+		uthread_create(&tid, NULL, &hammer, &args[i]);
+	}
+	gtthread_app_exit();
+	double elapsed = now() - start;
+
+	long total = 0;
+	for (int i = 0; i < lwp_count; i++)
+		total += args[i].acquired;
+	if (shared[0] != total) {
+		fprintf(stderr, "lost updates: %ld of %ld\n", total - shared[0],
+		        total);
+		return EXIT_FAILURE;
+	}
+	printf("%-8s lwps %3d  %10ld acquisitions in %8.3f s  %12.0f /s\n",
+	       GT_SPINLOCK_NAME, lwp_count, total, elapsed, total / elapsed);
+	free(args);
+	return 0;
+}
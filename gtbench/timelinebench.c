@@ -0,0 +1,118 @@
+/*
+ * timelinebench.c
+ *
+ * Times the structures the CFS timeline can be built on (see
+ * gtthreads/gt_timeline.h) with the operations CFS puts them through: filling
+ * a kthread's timeline with `count` uthreads, then picking the one with the
+ * least vruntime, charging it a slice and putting it back, over and over.
+ * Slices are weighted by a priority of 1 to 4, as cfs_update_vruntime() does.
+ *
+ * usage: timelinebench [count ...]   (10000 30000 100000 if none given)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <gt_rbtree.h>
+#include <gt_pheap.h>
+#include <gt_radixheap.h>
+
+#define PICKS 2000000
+/* a 1 ms slice, in ns */
+#define SLICE 1000000UL
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int seed;
+
+/* the same sequence of priorities and start keys for every structure */
+static unsigned long next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+/* defines bench_<name>(count), which prints ns per insert, per pick and
+ * reinsert, and per delete-min while draining */
+#define TIMELINE_BENCH(name, prefix, node_type, heap_type)		\
+typedef struct name##_entry {						\
+	node_type node;							\
+	unsigned long priority;						\
+} name##_entry_t;							\
+									\
+static void bench_##name(int count)					\
+{									\
+	name##_entry_t *entries = calloc(count, sizeof(*entries));	\
+	if (!entries) {							\
+		fprintf(stderr, "Malloc failure");			\
+		exit(EXIT_FAILURE);					\
+	}								\
+	heap_type heap;							\
+	prefix##init(&heap);						\
+	seed = 1;							\
+									\
+	double start = now();						\
+	for (int i = 0; i < count; i++) {				\
+		entries[i].priority = next_rand() % 4 + 1;		\
+		entries[i].node.key = next_rand() % SLICE;		\
+		prefix##insert(&heap, &entries[i].node);		\
+	}								\
+	double insert = now() - start;					\
+									\
+	start = now();							\
+	for (long i = 0; i < PICKS; i++) {				\
+		node_type *min = prefix##delete_min(&heap);		\
+		name##_entry_t *e = (name##_entry_t *) min; /* first */	\
+		min->key += SLICE * e->priority;			\
+		prefix##insert(&heap, min);				\
+	}								\
+	double pick = now() - start;					\
+									\
+	unsigned long last = 0;						\
+	int sorted = 1;							\
+	start = now();							\
+	for (int i = 0; i < count; i++) {				\
+		node_type *min = prefix##delete_min(&heap);		\
+		sorted &= min->key >= last;				\
+		last = min->key;					\
+	}								\
+	double drain = now() - start;					\
+	if (!sorted || prefix##delete_min(&heap)) {			\
+		fprintf(stderr, #name ": not in key order\n");		\
+		exit(EXIT_FAILURE);					\
+	}								\
+									\
+	printf("%-8s %7d uthreads  insert %7.1f  pick+reinsert %7.1f"	\
+	       "  drain %7.1f ns/op\n", #name, count,			\
+	       insert * 1e9 / count, pick * 1e9 / PICKS,		\
+	       drain * 1e9 / count);					\
+	free(entries);							\
+}
+
+TIMELINE_BENCH(rbtree, gt_rb_, gt_rb_node_t, gt_rb_tree_t)
+TIMELINE_BENCH(pairing, gt_ph_, gt_ph_node_t, gt_pheap_t)
+TIMELINE_BENCH(radix, gt_rh_, gt_rh_node_t, gt_radixheap_t)
+
+int main(int argc, char **argv)
+{
+	static const int default_counts[] = { 10000, 30000, 100000 };
+	int n = argc > 1 ? argc - 1 : 3;
+
+	for (int i = 0; i < n; i++) {
+		int count = argc > 1 ? atoi(argv[i + 1]) : default_counts[i];
+		if (count < 1) {
+			fprintf(stderr, "usage: %s [count ...]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+		bench_rbtree(count);
+		bench_pairing(count);
+		bench_radix(count);
+	}
+	return 0;
+}
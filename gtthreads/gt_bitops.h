@@ -1,38 +1,16 @@
 #ifndef GT_BITOPS_H_
 #define GT_BITOPS_H_
 
-/* None of these operations are atomic */
+/* Bitmaps are unsigned longs: 64 bits. None of these operations are atomic */
 
-#define SET_BIT(mask, off)				\
-do							\
-{							\
-	__asm__ __volatile__ ( "btsl %1,%0\n"		\
-				:"=m" (mask) /* 0 */	\
-				:"Ir" (off)  /* 1 */	\
-				:"%cc");		\
-} while(0)
+#define SET_BIT(mask, off) ((mask) |= 1UL << (off))
 
-#define RESET_BIT(mask, off)				\
-do							\
-{							\
-	__asm__ __volatile__ ( "btrl %1,%0\n"		\
-				:"=m" (mask) /* 0 */	\
-				:"Ir" (off)  /* 1 */	\
-				:"%cc");		\
-} while(0)
+#define RESET_BIT(mask, off) ((mask) &= ~(1UL << (off)))
 
-/* XXX: Can use bt instruction */
-#define IS_BIT_SET(mask, off) ((mask) & (1<<off))
+#define IS_BIT_SET(mask, off) (((mask) >> (off)) & 1)
 
-/* Least bit set corresponds to the highest priority */
-#define LOWEST_BIT_SET(mask)			\
-({						\
-	unsigned int inx;			\
-	__asm__ __volatile__("bsfl %1,%0\n"	\
-				:"=r"(inx)	\
-				:"r"(mask)	\
-				:"%cc");	\
-	inx;					\
-})
+/* Least bit set corresponds to the highest priority. `mask` must not be 0.
+ * Compiles to tzcnt (rep bsf) */
+#define LOWEST_BIT_SET(mask) ((unsigned int) __builtin_ctzl(mask))
 
 #endif /* GT_BITOPS_H_ */
@@ -0,0 +1,44 @@
+/*
+ * gt_clock.c
+ */
+
+#include <time.h>
+#include <cpuid.h>
+
+#include "gt_clock.h"
+
+/* how long gt_clock_init() watches both clocks for */
+#define GT_CLOCK_CALIBRATE_ns 1000000ULL /* 1 ms */
+
+unsigned long long gt_clock_tsc_mult = 0;
+
+static unsigned long long gt_clock_monotonic_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/* returns 1 if the TSC ticks at the same rate in every P- and C-state */
+static int gt_clock_tsc_invariant(void)
+{
+	unsigned eax, ebx, ecx, edx;
+	if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx)
+	    || eax < 0x80000007)
+		return 0;
+	__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+	return (edx >> 8) & 1;
+}
+
+void gt_clock_init(void)
+{
+	if (gt_clock_tsc_mult || !gt_clock_tsc_invariant())
+		return;
+	unsigned long long ns0 = gt_clock_monotonic_ns(), ns1;
+	unsigned long long tsc0 = gt_clock_rdtsc(), tsc1;
+	do {
+		ns1 = gt_clock_monotonic_ns();
+		tsc1 = gt_clock_rdtsc();
+	} while (ns1 - ns0 < GT_CLOCK_CALIBRATE_ns);
+	gt_clock_tsc_mult = ((ns1 - ns0) << 32) / (tsc1 - tsc0);
+}
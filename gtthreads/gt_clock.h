@@ -0,0 +1,45 @@
+/*
+ * gt_clock.h
+ *
+ * The clock slices are measured with: a nanosecond count read without
+ * entering the kernel
+ *
+ */
+
+#ifndef GT_CLOCK_H_
+#define GT_CLOCK_H_
+
+#include <time.h>
+
+/* ns per TSC tick in 32.32 fixed point, 0 if the TSC can't be used. Set by
+ * gt_clock_init() */
+extern unsigned long long gt_clock_tsc_mult;
+
+/* calibrates the TSC against CLOCK_MONOTONIC, taking about a millisecond, if
+ * the cpu says it ticks at a constant rate. Idempotent */
+void gt_clock_init(void);
+
+/* Inlines */
+static inline unsigned long long gt_clock_rdtsc(void)
+{
+	unsigned lo, hi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return (unsigned long long) hi << 32 | lo;
+}
+
+/* returns the time in ns from an arbitrary start: the scaled TSC, else
+ * CLOCK_MONOTONIC, which the vDSO serves. Wall time, so time the OS has the
+ * kthread descheduled counts; kthreads are pinned one to a cpu, which keeps
+ * that rare */
+static inline unsigned long long gt_clock_ns(void)
+{
+	if (gt_clock_tsc_mult)
+		return __extension__ (unsigned long long)
+		        (((unsigned __int128) gt_clock_rdtsc()
+		          * gt_clock_tsc_mult) >> 32);
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+#endif /* GT_CLOCK_H_ */
@@ -61,5 +61,23 @@ static inline void *ecalloc(size_t size)
 	return(__ptr);
 }
 
+static inline void *erealloc(void *ptr, size_t size)
+{
+	void *__ptr;
+	gt_spin_lock(&MALLOC_LOCK);
+	__ptr = realloc(ptr, size);
+	gt_spin_unlock(&MALLOC_LOCK);
+	if (!__ptr)
+		fail("realloc");
+	return(__ptr);
+}
+
+static inline void efree(void *ptr)
+{
+	gt_spin_lock(&MALLOC_LOCK);
+	free(ptr);
+	gt_spin_unlock(&MALLOC_LOCK);
+}
+
 
 #endif /* GT_COMMON_H_ */
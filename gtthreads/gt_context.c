@@ -0,0 +1,112 @@
+/*
+ * gt_context.c
+ *
+ * Register-only context switching. See gt_context.h
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "gt_context.h"
+#include "gt_common.h"
+
+#ifndef GT_USE_UCONTEXT
+
+/* Saved frame, from the lowest address (ctx->sp) up:
+ *   mxcsr (4 bytes), x87 control word (2 bytes), padding (2 bytes)
+ *   r15, r14, r13, r12, rbx, rbp
+ *   return address
+ * which is exactly what gt_context_switch() pushes. */
+#define GT_CONTEXT_FRAME_WORDS 8
+
+__asm__ (
+	".text\n"
+	".globl gt_context_switch\n"
+	".type gt_context_switch,@function\n"
+	"gt_context_switch:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq (%rsi), %rsp\n"
+	"	jmp gt_context_restore\n"
+	".size gt_context_switch,.-gt_context_switch\n"
+
+	".globl gt_context_set\n"
+	".type gt_context_set,@function\n"
+	"gt_context_set:\n"
+	"	movq (%rdi), %rsp\n"
+	"gt_context_restore:\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size gt_context_set,.-gt_context_set\n"
+
+	/* first "return" into a new context lands here, with the entry
+	 * function in %rbx and a 16-byte aligned stack */
+	".type gt_context_trampoline,@function\n"
+	"gt_context_trampoline:\n"
+	"	callq *%rbx\n"
+	"	ud2\n"
+	".size gt_context_trampoline,.-gt_context_trampoline\n"
+);
+
+void gt_context_trampoline(void);
+
+void gt_context_make(gt_context_t *ctx, void *stack, size_t stack_size,
+                     void (*func)(void))
+{
+	/* the return address must sit at 8 mod 16 so the trampoline's call
+	 * sees the alignment the ABI expects */
+	uintptr_t top = ((uintptr_t) stack + stack_size) & ~(uintptr_t) 0xf;
+	uint64_t *ret = (uint64_t *) (top - 24);
+	uint64_t *frame = ret - (GT_CONTEXT_FRAME_WORDS - 1);
+
+	memset(frame, 0, GT_CONTEXT_FRAME_WORDS * sizeof(*frame));
+	*(uint32_t *) frame = 0x1f80;		/* default mxcsr */
+	*((uint16_t *) frame + 2) = 0x037f;	/* default x87 control word */
+	frame[5] = (uint64_t) (uintptr_t) func;	/* rbx */
+	*ret = (uint64_t) (uintptr_t) gt_context_trampoline;
+	ctx->sp = frame;
+}
+
+#else /* GT_USE_UCONTEXT */
+
+void gt_context_make(gt_context_t *ctx, void *stack, size_t stack_size,
+                     void (*func)(void))
+{
+	if (getcontext(&ctx->uc) == -1)
+		fail_perror("getcontext");
+	ctx->uc.uc_stack.ss_sp = stack;
+	ctx->uc.uc_stack.ss_size = stack_size;
+	ctx->uc.uc_stack.ss_flags = 0;
+	ctx->uc.uc_link = NULL;
+	makecontext(&ctx->uc, func, 0);
+}
+
+void gt_context_switch(gt_context_t *from, gt_context_t *to)
+{
+	if (swapcontext(&from->uc, &to->uc) == -1)
+		fail_perror("swapcontext");
+}
+
+void gt_context_set(gt_context_t *to)
+{
+	setcontext(&to->uc);
+	fail_perror("setcontext");
+}
+
+#endif /* GT_USE_UCONTEXT */
@@ -0,0 +1,49 @@
+/*
+ * gt_context.h
+ *
+ * Execution contexts for uthreads and the kthread scheduler stacks.
+ *
+ * By default a context is just a saved stack pointer: switching pushes the
+ * callee-saved registers (and the FPU control words) on the old stack, swaps
+ * stacks and pops them off the new one. Unlike swapcontext(3), this never
+ * enters the kernel, so the signal mask is *not* saved or restored; see
+ * kthread_sched_signal_restore().
+ *
+ * Build with -DGT_USE_UCONTEXT (or on anything other than x86-64) to fall back
+ * on getcontext/makecontext/swapcontext.
+ */
+
+#ifndef GT_CONTEXT_H_
+#define GT_CONTEXT_H_
+
+#include <stddef.h>
+
+#if !defined(__x86_64__) && !defined(GT_USE_UCONTEXT)
+#define GT_USE_UCONTEXT
+#endif
+
+#ifdef GT_USE_UCONTEXT
+#include <ucontext.h>
+#endif
+
+typedef struct gt_context {
+#ifdef GT_USE_UCONTEXT
+	ucontext_t uc;
+#else
+	void *sp; /* top of the saved register frame */
+#endif
+} gt_context_t;
+
+/* sets up `ctx` so that switching to it calls func() on the given stack.
+ * func() must never return */
+void gt_context_make(gt_context_t *ctx, void *stack, size_t stack_size,
+                     void (*func)(void));
+
+/* saves the running context in `from` and resumes `to`. Returns when
+ * something switches back to `from` */
+void gt_context_switch(gt_context_t *from, gt_context_t *to);
+
+/* resumes `to`, discarding the running context */
+void gt_context_set(gt_context_t *to) __attribute__((noreturn));
+
+#endif /* GT_CONTEXT_H_ */
@@ -7,13 +7,16 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <sys/wait.h>
 #include <sys/time.h>
 #include <time.h>
 #include <signal.h>
 #include <sched.h>
 #include <string.h>
+#include <errno.h>
 #include <assert.h>
-#include <ucontext.h>
+#include <asm/prctl.h>
+#include <linux/futex.h>
 
 #include "gt_kthread.h"
 #include "gt_uthread.h"
@@ -21,37 +24,75 @@
 #include "gt_scheduler.h"
 #include "gt_signal.h"
 
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
 #define KTHREAD_DEFAULT_SSIZE (256 * 1024)
-#define KTHREAD_MAX_COUNT 16
+
+/* how many times an idle kthread polls for work before sleeping in the
+ * kernel */
+#define KTHREAD_PARK_SPIN 1000
 
 extern scheduler_t scheduler;
-extern int kthread_count;
-extern gt_spinlock_t kthread_count_lock;
+/* number of kthreads done with kthread_start()'s setup. Each one wakes
+ * kthread_wait_ready() to recount */
+static volatile int kthread_ready_count = 0;
+
+/* makes kthread_current_kthread() return `k_ctx` on the calling kthread */
+static void kthread_set_current(kthread_t *k_ctx)
+{
+	k_ctx->self = k_ctx;
+	if (syscall(SYS_arch_prctl, ARCH_SET_GS, k_ctx))
+		fail_perror("arch_prctl");
+}
 
-kthread_t *_kthread_cpu_map[KTHREAD_MAX_COUNT];
-gt_spinlock_t cpu_map_lock = GT_SPINLOCK_INITIALIZER;
+/* what the application thread's %gs points at. self stays NULL */
+static kthread_t kthread_app_thread;
+static int kthread_app_thread_ready = 0;
 
-/* Toggled on when a child kthread is created, cloned, and ready to be
- * scheduled. The parent should toggle it off before creating the next
- * kthread. */
-volatile sig_atomic_t kthread_is_ready = 0;
+void kthread_init_app_thread(void)
+{
+	if (kthread_app_thread_ready)
+		return;
+	kthread_app_thread.slab_heap = gt_slab_heap_get();
+	if (syscall(SYS_arch_prctl, ARCH_SET_GS, &kthread_app_thread))
+		fail_perror("arch_prctl");
+	kthread_app_thread_ready = 1;
+}
 
-void kthread_ready_handler(int signo)
+void *kthread_slab_alloc(size_t size)
 {
-	kthread_is_ready = 1;
+	/* until gtthread_app_init() nothing but the application thread runs,
+	 * and its %gs isn't set up yet */
+	if (!kthread_app_thread_ready)
+		kthread_init_app_thread();
+	kthread_t *k_ctx = uthread_preempt_disable();
+	void *obj = gt_slab_alloc(k_ctx ? k_ctx->slab_heap
+	                                : kthread_app_thread.slab_heap, size);
+	uthread_preempt_enable(k_ctx);
+	return obj;
 }
 
-/* returns the currently running kthread */
-kthread_t *kthread_current_kthread()
+void *kthread_slab_calloc(size_t size)
 {
-	gt_spin_lock(&cpu_map_lock);
-	kthread_t *k_ctx = _kthread_cpu_map[kthread_apic_id()];
-	gt_spin_unlock(&cpu_map_lock);
-	assert(k_ctx != NULL);
-	return k_ctx;
+	void *obj = kthread_slab_alloc(size);
+	memset(obj, 0, size);
+	return obj;
+}
+
+void kthread_slab_free(void *obj)
+{
+	if (!kthread_app_thread_ready)
+		kthread_init_app_thread();
+	kthread_t *k_ctx = uthread_preempt_disable();
+	gt_slab_free(k_ctx ? k_ctx->slab_heap : kthread_app_thread.slab_heap,
+	             obj);
+	uthread_preempt_enable(k_ctx);
 }
 
 int can_exit = 0;
+volatile int kthread_idle_count = 0;
 
 /* returns 1 if a kthread is schedulable, 0 otherwise */
 int kthread_is_schedulable(kthread_t *k_ctx) {
@@ -59,14 +100,51 @@ int kthread_is_schedulable(kthread_t *k_ctx) {
 		  k_ctx->state == KTHREAD_INIT ));
 }
 
+/* we share the address space (and stdio buffers) with the application, so
+ * leave without running atexit handlers. kthread_join() frees our memory */
 static void kthread_exit(kthread_t *k_ctx)
 {
 	checkpoint("k%d: exiting", k_ctx->cpuid);
-	gt_spin_lock(&kthread_count_lock);
-	kthread_count--;
-	gt_spin_unlock(&kthread_count_lock);
-	free(k_ctx);
-	exit(EXIT_SUCCESS);
+	gt_stack_pool_destroy(&k_ctx->stack_pool);
+	gt_slab_heap_put(k_ctx->slab_heap);
+	_exit(EXIT_SUCCESS);
+}
+
+void kthread_preempt_current(kthread_t *k_ctx)
+{
+	do {
+		k_ctx->in_scheduler = 1;
+		k_ctx->preempt_pending = 0;
+		gt_context_make(&k_ctx->sched_ctx, k_ctx->sched_ctx_stack,
+		                sizeof(k_ctx->sched_ctx_stack), schedule);
+		checkpoint("%s", "Switching to schedule context");
+		gt_context_switch(&k_ctx->current_uthread->context,
+		                  &k_ctx->sched_ctx);
+
+		/* resumed; not necessarily where we left off */
+		k_ctx = kthread_current_kthread();
+		k_ctx->in_scheduler = 0;
+	} while (k_ctx->preempt_pending);
+	/* whoever switched back to us may have come from inside the SIGSCHED
+	 * handler, leaving it blocked; if we were preempted from the handler
+	 * ourselves, returning from it unblocks it again anyway */
+	kthread_sched_signal_restore(k_ctx);
+}
+
+void kthread_finish_current(kthread_t *k_ctx)
+{
+	k_ctx->in_scheduler = 1;
+	gt_context_make(&k_ctx->sched_ctx, k_ctx->sched_ctx_stack,
+	                sizeof(k_ctx->sched_ctx_stack), schedule);
+	gt_context_set(&k_ctx->sched_ctx);
+}
+
+void kthread_sched_signal_restore(kthread_t *k_ctx)
+{
+	if (k_ctx->sched_signal_blocked) {
+		k_ctx->sched_signal_blocked = 0;
+		sig_unblock_signal(SIGSCHED);
+	}
 }
 
 /* signal handler for SIGSCHED. */
@@ -74,53 +152,161 @@ void kthread_sched_handler(int signo)
 {
 	checkpoint("%s", "***Entering signal handler***");
 	kthread_t *k_ctx = kthread_current_kthread();
+	k_ctx->sched_signal_blocked = 1;
+	if (k_ctx->in_scheduler || (k_ctx->current_uthread
+	                            && k_ctx->current_uthread->preempt_disabled)) {
+		/* the scheduler is already running, or the uthread asked not
+		 * to be moved; have it go around again once it's safe */
+		k_ctx->preempt_pending = 1;
+		k_ctx->sched_signal_blocked = 0;
+		return;
+	}
+
 	k_ctx->state = KTHREAD_RUNNING;
 	if (k_ctx->current_uthread) {
-		uthread_attr_set_elapsed_cpu_time(k_ctx->current_uthread->attr);
-
-		if (getcontext(&k_ctx->sched_ctx) == -1)
-			fail_perror("getcontext");
-		makecontext(&k_ctx->sched_ctx, schedule, 0, 0);
-		checkpoint("%s", "Swapping to schedule context");
-		if (swapcontext(&k_ctx->current_uthread->context,
-				&k_ctx->sched_ctx) == -1)
-			fail_perror("swapcontext");
+		kthread_preempt_current(k_ctx);
 	} else {
 		schedule();
 	}
 
-	k_ctx = kthread_current_kthread(); // not sure if i trust my stack; call again
-	gettimeofday(&k_ctx->current_uthread->attr->timeslice_start, NULL);
+	/* returning from the handler unblocks SIGSCHED again */
+	k_ctx = kthread_current_kthread();
+	k_ctx->sched_signal_blocked = 0;
 	checkpoint("k%d: exiting handler", k_ctx->cpuid);
 }
 
-/* blocks until there is a uthread to schedule */
-void kthread_wait_for_uthread(kthread_t *k_ctx)
+/* what is left on the timer may be off from the slice asked for by this much,
+ * or by 1/KTHREAD_TIMER_SLACK_DIV of the slice if that is more, and still do.
+ * Schedulers that charge a uthread more than it ran, like PCS, would otherwise
+ * re-arm on every yield */
+#define KTHREAD_TIMER_SLACK_ns 50000ULL /* 50 us */
+#define KTHREAD_TIMER_SLACK_DIV 8
+
+void kthread_set_timeslice(kthread_t *k_ctx, unsigned long timeslice_us)
+{
+	k_ctx->tickless = (timeslice_us == 0);
+	unsigned long long now = k_ctx->switch_ns;
+	unsigned long long slice_ns = timeslice_us * 1000ULL;
+	if (timeslice_us) {
+		unsigned long long left = k_ctx->timer_expiry_ns > now
+		        ? k_ctx->timer_expiry_ns - now : 0;
+		unsigned long long slack = slice_ns / KTHREAD_TIMER_SLACK_DIV;
+		if (slack < KTHREAD_TIMER_SLACK_ns)
+			slack = KTHREAD_TIMER_SLACK_ns;
+		if (left && left + slack >= slice_ns
+		    && left <= slice_ns + slack)
+			return;
+	} else if (!k_ctx->timer_expiry_ns) {
+		return;
+	}
+
+	/* one shot: once it has gone off, left is 0 and the next dispatch
+	 * arms it again */
+	struct itimerspec timeslice;
+	timeslice.it_value.tv_sec = timeslice_us / 1000000;
+	timeslice.it_value.tv_nsec = (timeslice_us % 1000000) * 1000;
+	timeslice.it_interval.tv_sec = 0;
+	timeslice.it_interval.tv_nsec = 0;
+	if (timer_settime(k_ctx->timer, 0, &timeslice, NULL))
+		fail_perror("timer_settime");
+	k_ctx->timer_expiry_ns = timeslice_us ? now + slice_ns : 0;
+}
+
+void kthread_unpark(kthread_t *k_ctx)
 {
-	struct timespec interval = {
-		.tv_sec = 1,
-		.tv_nsec = 0
-	};
+	__sync_fetch_and_add(&k_ctx->wakeup_seq, 1);
+	syscall(SYS_futex, &k_ctx->wakeup_seq, FUTEX_WAKE_PRIVATE, 1,
+	        NULL, NULL, 0);
+}
 
-	while (!(k_ctx->state == KTHREAD_DONE && can_exit)) {
-		checkpoint("State is %d and can_exit is %d",
-		           k_ctx->state, can_exit);
-		checkpoint("k%d: kthread (%d) waiting for first uthread",
-		           k_ctx->cpuid, k_ctx->tid);
-		/* Must use nanosleep so as not to interfere with SIGALRM
-		 * and other signals */
-		nanosleep(&interval, NULL);
+void kthread_kick(kthread_t *k_ctx)
+{
+	__sync_synchronize();
+	if (k_ctx->state == KTHREAD_DONE) {
+		checkpoint("k%d: Unparking kthread", k_ctx->cpuid);
+		kthread_unpark(k_ctx);
+	} else if (k_ctx->tickless) {
+		checkpoint("k%d: Sending SIGSCHED to kthread", k_ctx->cpuid);
+		kill(k_ctx->tid, SIGSCHED);
 	}
-	checkpoint("k%d: exiting wait for uthread", k_ctx->cpuid);
-	kthread_exit(k_ctx);
 }
 
-static void kthread_init_context(kthread_t *kthread)
+void kthread_resched(kthread_t *k_ctx)
 {
-	kthread->sched_ctx.uc_stack.ss_sp = kthread->sched_ctx_stack;
-	kthread->sched_ctx.uc_stack.ss_size = sizeof(kthread->sched_ctx_stack);
-	kthread->sched_ctx.uc_stack.ss_flags = 0;
-	kthread->sched_ctx.uc_link = NULL;
+	__sync_synchronize();
+	if (k_ctx->state == KTHREAD_DONE)
+		kthread_unpark(k_ctx);
+	else
+		kill(k_ctx->tid, SIGSCHED);
+}
+
+/* waits for kthread_unpark(), unless it has already been called since
+ * wakeup_seq was `seq`. Spins briefly first, since work often shows up
+ * right after we run out */
+static void kthread_park(kthread_t *k_ctx, unsigned seq)
+{
+	for (int i = 0; i < KTHREAD_PARK_SPIN; i++) {
+		if (k_ctx->wakeup_seq != seq)
+			return;
+		__asm__ __volatile__ ("pause\n");
+	}
+	checkpoint("k%d: parking", k_ctx->cpuid);
+	syscall(SYS_futex, &k_ctx->wakeup_seq, FUTEX_WAIT_PRIVATE, seq,
+	        NULL, NULL, 0);
+}
+
+/* creates the kthread's slice timer, disarmed. Measures the kthread's own cpu
+ * time, like ITIMER_VIRTUAL, and signals only this kthread */
+static void kthread_init_timer(kthread_t *k_ctx)
+{
+	struct sigevent sev;
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = SIGSCHED;
+	sev.sigev_notify_thread_id = k_ctx->tid;
+	if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &k_ctx->timer))
+		fail_perror("timer_create");
+	k_ctx->timer_expiry_ns = 0;
+	k_ctx->tickless = 0;
+}
+
+/* picks the next uthread, parking the kthread until one is posted */
+uthread_t *kthread_wait_for_uthread(kthread_t *k_ctx)
+{
+	uthread_t *next_uthread;
+	unsigned seq;
+	int idled = 0;
+	for (;;) {
+		seq = k_ctx->wakeup_seq;
+		if ((next_uthread = scheduler.pick_next_uthread(k_ctx)))
+			break;
+		if (k_ctx->state != KTHREAD_DONE) {
+			/* go idle, then look once more before parking. The
+			 * atomic add is a full barrier, pairing with the one in
+			 * kthread_kick() */
+			checkpoint("k%d: Setting state to DONE, wait for more "
+			           "uthreads", k_ctx->cpuid);
+			k_ctx->state = KTHREAD_DONE;
+			k_ctx->current_uthread = NULL;
+			kthread_set_timeslice(k_ctx, 0);
+			idled = 1;
+			__sync_add_and_fetch(&kthread_idle_count, 1);
+			continue;
+		}
+		if (can_exit) {
+			checkpoint("k%d: exiting wait for uthread",
+			           k_ctx->cpuid);
+			kthread_exit(k_ctx);
+		}
+		kthread_park(k_ctx, seq);
+	}
+	/* the next slice starts now, not when schedule() was entered */
+	if (idled) {
+		k_ctx->switch_ns = gt_clock_ns();
+		__sync_sub_and_fetch(&kthread_idle_count, 1);
+	}
+	k_ctx->state = KTHREAD_RUNNING;
+	return next_uthread;
 }
 
 /* main function is to set the cpu affinity */
@@ -133,9 +319,6 @@ static void kthread_set_cpu_affinity(kthread_t *k_ctx)
 	                  &cpu_affinity_mask);
 
 	sched_yield(); /* gets us on our target cpu */
-
-	k_ctx->cpu_apic_id = kthread_apic_id();
-	_kthread_cpu_map[k_ctx->cpu_apic_id] = k_ctx;
 	return;
 }
 
@@ -144,13 +327,19 @@ static int kthread_start(void *arg)
 	kthread_t *k_ctx = arg;
 	k_ctx->pid = getpid();
 	k_ctx->tid = k_ctx->pid;
+	kthread_set_current(k_ctx);
 	kthread_set_cpu_affinity(k_ctx);
-	kthread_init_context(k_ctx);
+	kthread_init_timer(k_ctx);
+	gt_stack_pool_init(&k_ctx->stack_pool);
+	k_ctx->slab_heap = gt_slab_heap_get();
 	scheduler.kthread_init(k_ctx);
 	k_ctx->state = KTHREAD_RUNNABLE;
 	sig_install_handler_and_unblock(SIGSCHED, &kthread_sched_handler);
-	kill(getppid(), SIGUSR1); // signals that we are ready for scheduling
-	kthread_wait_for_uthread(k_ctx);
+	/* signals that we are ready for scheduling */
+	__sync_add_and_fetch(&kthread_ready_count, 1);
+	syscall(SYS_futex, &kthread_ready_count, FUTEX_WAKE_PRIVATE, 1,
+	        NULL, NULL, 0);
+	schedule();
 	return 0;
 }
 
@@ -161,27 +350,39 @@ kthread_t *kthread_create(pid_t *tid, int lwp)
 	/* Create the new thread's stack */
 	size_t stacksize = KTHREAD_DEFAULT_SSIZE;
 	char *stack = ecalloc(stacksize);
-	stack += stacksize;  // grows down
 
 	/* set up the context */
 	kthread_t *k_ctx = ecalloc(sizeof(*k_ctx));
 	k_ctx->cpuid = lwp;
 	k_ctx->state = KTHREAD_INIT;
-
-	/* Install the handler to be notified when this child kthread will
-	 * ready to be scheduled */
-	sig_install_handler_and_unblock(SIGUSR1, &kthread_ready_handler);
+	k_ctx->stack = stack;
+	stack += stacksize;  // grows down
 
 	int flags = CLONE_VM | CLONE_FS | CLONE_FILES | SIGCHLD;
 	*tid = clone(kthread_start, (void *) stack, flags, (void *) k_ctx);
 	if (*tid < 0) {
 		perror("clone");
+		free(k_ctx->stack);
 		free(k_ctx);
 		return NULL;
 	}
-
-	while (!kthread_is_ready)
-		sleep(1);
-	kthread_is_ready = 0;
 	return k_ctx;
 }
+
+void kthread_join(kthread_t *k_ctx)
+{
+	checkpoint("k%d: joining", k_ctx->cpuid);
+	while (waitpid(k_ctx->tid, NULL, 0) == -1)
+		if (errno != EINTR)
+			fail_perror("waitpid");
+	free(k_ctx->stack);
+	free(k_ctx);
+}
+
+void kthread_wait_ready(int count)
+{
+	int ready;
+	while ((ready = kthread_ready_count) < count)
+		syscall(SYS_futex, &kthread_ready_count, FUTEX_WAIT_PRIVATE,
+		        ready, NULL, NULL, 0);
+}
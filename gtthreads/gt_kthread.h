@@ -7,7 +7,13 @@
 #define GT_KTHREAD_H_
 
 #include <signal.h>
-#include <ucontext.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "gt_clock.h"
+#include "gt_context.h"
+#include "gt_stack.h"
+#include "gt_slab.h"
 
 struct uthread;
 
@@ -18,51 +24,150 @@ enum kthread_state {
 	KTHREAD_DONE
 };
 
+/* the scheduler runs on its own stack, so that it never has to run on the
+ * stack of a uthread it may hand to someone else. Big enough for a signal
+ * frame, since an idle kthread takes SIGSCHED on it */
+#define KTHREAD_SCHED_SSIZE (16 * 1024)
+
 typedef struct kthread {
+	/* must stay first: every kthread's %gs base points at its kthread_t, so
+	 * %gs:0 reads this back. See kthread_current_kthread() */
+	struct kthread *self;
 	enum kthread_state state;
 	unsigned cpuid;
-	unsigned cpu_apic_id;
 	pid_t pid;
 	pid_t tid;
+	void *stack; /* bottom of the clone()d stack */
 	struct uthread *current_uthread;
-	ucontext_t sched_ctx;
-	char sched_ctx_stack[2048];
+	/* set while schedule() owns the cpu; SIGSCHED arriving then is
+	 * deferred through preempt_pending */
+	volatile sig_atomic_t in_scheduler;
+	volatile sig_atomic_t preempt_pending;
+	/* 1 while SIGSCHED is blocked because we left its handler with a
+	 * register-only context switch */
+	volatile sig_atomic_t sched_signal_blocked;
+	/* gt_clock_ns() at the last switch, taken once by schedule(): the end
+	 * of the slice switched out and the start of the one switched in */
+	unsigned long long switch_ns;
+	/* per-kthread one-shot cpu-time timer raising SIGSCHED at the end of
+	 * the slice, expected around timer_expiry_ns on gt_clock_ns() (0
+	 * while disarmed). `tickless` is set while it is off with a uthread on
+	 * the cpu */
+	timer_t timer;
+	unsigned long long timer_expiry_ns;
+	volatile sig_atomic_t tickless;
+	/* futex an idle (KTHREAD_DONE) kthread parks on; bumped by
+	 * kthread_unpark() */
+	volatile unsigned wakeup_seq;
+	gt_stack_pool_t stack_pool; /* uthread stacks */
+	gt_slab_heap_t *slab_heap; /* see kthread_slab_alloc() */
+	gt_context_t sched_ctx;
+	char sched_ctx_stack[KTHREAD_SCHED_SSIZE];
 } kthread_t;
 
 
+/* kthreads idle in kthread_wait_for_uthread(), parked or about to be. An
+ * idle kthread only looks for work when unparked, so schedulers read this to
+ * tell when a busy kthread should hand some over */
+extern volatile int kthread_idle_count;
+
 /* create a kthread running on the specified lwp. The new thread's pid is
  * returned in `tid`. Returns a pointer to the new kthread_t if sucessfull,
- * NULL otherwise. */
-kthread_t *kthread_create(pid_t *tid, int lwp);
+ * NULL otherwise. Doesn't wait for the kthread to come up; see
+ * kthread_wait_ready() */
+kthread_t *kthread_create(pid_t *tid, int lwp);
+
+/* points the application thread's %gs at an empty kthread_t, so that
+ * kthread_current_kthread() returns NULL there. Idempotent */
+void kthread_init_app_thread(void);
+
+/* allocate and free the library's small fixed-size objects from the calling
+ * thread's slab heap, without taking MALLOC_LOCK. Usable from uthreads and
+ * the application thread, even before gtthread_app_init(). The scheduler
+ * itself should use gt_slab_alloc()/gt_slab_free() on k_ctx->slab_heap */
+void *kthread_slab_alloc(size_t size);
+void *kthread_slab_calloc(size_t size);
+void kthread_slab_free(void *obj);
 
-/* returns the currently running kthread */
-kthread_t *kthread_current_kthread();
+/* blocks until `count` kthreads are ready to be scheduled */
+void kthread_wait_ready(int count);
+
+/* waits for `k_ctx` to exit and frees it */
+void kthread_join(kthread_t *k_ctx);
 
 /* returns 1 if a kthread is schedulable, 0 otherwise */
 int kthread_is_schedulable(kthread_t *k_ctx);
 
 void kthread_sched_handler(int signo);
 
-/* Blocks until a uthread is available to schedule */
-void kthread_wait_for_uthread(kthread_t *k_ctx);
+/* Saves the current uthread and switches to schedule() on the kthread's
+ * scheduler stack. Returns once the uthread is resumed, possibly on a
+ * different kthread, with SIGSCHED unblocked */
+void kthread_preempt_current(kthread_t *k_ctx);
+
+/* Leaves the current uthread, which must be done, for good: enters schedule()
+ * on the scheduler stack so the uthread's stack can be reused */
+void kthread_finish_current(kthread_t *k_ctx) __attribute__((noreturn));
+
+/* Unblocks SIGSCHED if we got here by switching out of its handler. Must be
+ * called wherever a uthread resumes outside of the handler */
+void kthread_sched_signal_restore(kthread_t *k_ctx);
+
+/* Gives the uthread being dispatched a slice of `timeslice_us` of cpu time;
+ * 0 stops the timer. The timer is one shot, so it is re-armed on every
+ * dispatch after it has expired; one still running is left alone if what is
+ * left on it is within an eighth of the slice asked for (and at least 50 us)
+ * either way. Times that with the switch's k_ctx->switch_ns rather than
+ * reading a clock. Schedulers call this from their resume_uthread hook, after
+ * kthread_tickless_prepare() */
+void kthread_set_timeslice(kthread_t *k_ctx, unsigned long timeslice_us);
+
+/* Tells `k_ctx` a uthread has been posted to it: unparks it if it is idle,
+ * raises SIGSCHED if it is running without ticks */
+void kthread_kick(kthread_t *k_ctx);
+
+/* Has `k_ctx` pick a uthread again now: unparks it if it is idle, raises
+ * SIGSCHED otherwise */
+void kthread_resched(kthread_t *k_ctx);
+
+/* Wakes `k_ctx` if it is parked in kthread_wait_for_uthread() */
+void kthread_unpark(kthread_t *k_ctx);
+
+/* Returns the next uthread to run. Blocks until one is available; exits the
+ * kthread instead if gtthread_app_exit() has been called */
+struct uthread *kthread_wait_for_uthread(kthread_t *k_ctx);
 
 /* Inlines */
-/* apic-id of the cpu on which kthread is running */
-static inline unsigned char kthread_apic_id(void)
+/* Call before checking whether anything else is runnable to decide on going
+ * tickless. Pairs with the barrier in kthread_kick(): either we see the new
+ * uthread, or the poster sees `tickless` and kicks us */
+static inline void kthread_tickless_prepare(kthread_t *k_ctx)
+{
+	k_ctx->tickless = 1;
+	__sync_synchronize();
+}
+
+/* returns the currently running kthread, NULL on the application thread.
+ * glibc leaves %gs alone on x86-64, so
+ * each kthread points its %gs base at itself when it starts. volatile, as the
+ * answer changes when a uthread is resumed on another kthread */
+static inline kthread_t *kthread_current_kthread(void)
+{
+	kthread_t *k_ctx;
+	__asm__ __volatile__ ("movq %%gs:0, %0" : "=r" (k_ctx));
+	return k_ctx;
+}
+
+/* sets in_scheduler on the calling kthread, then returns it. The store is
+ * %gs-relative, so no SIGSCHED can move the uthread between finding its
+ * kthread and marking it: once marked, SIGSCHED is deferred. For uthreads
+ * about to call kthread_preempt_current() */
+static inline kthread_t *kthread_enter_scheduler(void)
 {
-/* IO APIC id is unique for a core and can be used as cpuid.
- * EBX[31:24] Bits 24-31 (8 bits) return the 8-bit unique.
- * Initial APIC ID for the processor this code is running on.*/
-#define INITIAL_APIC_ID_BITS  0xFF000000
-	unsigned int Regebx = 0;
-	__asm__ __volatile__ (
-		"movl $1, %%eax\n\t"
-		"cpuid"
-		:"=b" (Regebx)
-		: :"%eax","%ecx","%edx");
-
-	return((unsigned char)((Regebx & INITIAL_APIC_ID_BITS) >> 24));
-#undef INITIAL_APIC_ID_BITS
+	__asm__ __volatile__ ("movl $1, %%gs:%c0"
+	                      : : "i" (offsetof(kthread_t, in_scheduler))
+	                      : "memory");
+	return kthread_current_kthread();
 }
 
 
@@ -0,0 +1,65 @@
+/*
+ * gt_pheap.c
+ */
+
+#include "gt_pheap.h"
+
+void gt_ph_init(gt_pheap_t *heap)
+{
+	heap->root = NULL;
+}
+
+/* makes the root with the larger key the first child of the other, returns
+ * the new root. Neither may be NULL */
+static inline gt_ph_node_t *gt_ph_meld(gt_ph_node_t *a, gt_ph_node_t *b)
+{
+	if (b->key < a->key) {
+		gt_ph_node_t *t = a;
+		a = b;
+		b = t;
+	}
+	b->next = a->child;
+	a->child = b;
+	return a;
+}
+
+void gt_ph_insert(gt_pheap_t *heap, gt_ph_node_t *node)
+{
+	node->child = NULL;
+	node->next = NULL;
+	heap->root = heap->root ? gt_ph_meld(heap->root, node) : node;
+}
+
+gt_ph_node_t *gt_ph_delete_min(gt_pheap_t *heap)
+{
+	gt_ph_node_t *min = heap->root;
+	if (!min)
+		return NULL;
+
+	/* first pass: meld the children in pairs, left to right, stacking the
+	 * results on `pairs` through their next pointers */
+	gt_ph_node_t *pairs = NULL, *a, *b, *rest = min->child;
+	while ((a = rest)) {
+		if ((b = a->next)) {
+			rest = b->next;
+			a = gt_ph_meld(a, b);
+		} else {
+			rest = NULL;
+		}
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* second pass: meld the pairs into one, right to left */
+	gt_ph_node_t *root = pairs;
+	if (root) {
+		pairs = root->next;
+		root->next = NULL;
+		while ((a = pairs)) {
+			pairs = a->next;
+			root = gt_ph_meld(root, a);
+		}
+	}
+	heap->root = root;
+	return min;
+}
@@ -0,0 +1,41 @@
+/*
+ * gt_pheap.h
+ *
+ * Intrusive pairing heap keyed on an unsigned long, one of the CFS timelines
+ * (see gt_timeline.h). Inserting is a single comparison; the work is put off
+ * to gt_ph_delete_min(), which pairs up the old minimum's children, in
+ * amortized O(log n).
+ */
+
+#ifndef GT_PHEAP_H_
+#define GT_PHEAP_H_
+
+#include <stddef.h>
+
+typedef struct gt_ph_node {
+	struct gt_ph_node *child;	/* first child */
+	struct gt_ph_node *next;	/* next sibling */
+	unsigned long key;
+} gt_ph_node_t;
+
+typedef struct gt_pheap {
+	gt_ph_node_t *root;
+} gt_pheap_t;
+
+void gt_ph_init(gt_pheap_t *heap);
+void gt_ph_insert(gt_pheap_t *heap, gt_ph_node_t *node);
+/* removes and returns the node with the smallest key, NULL if empty */
+gt_ph_node_t *gt_ph_delete_min(gt_pheap_t *heap);
+
+/* the node with the smallest key, NULL if the heap is empty */
+static inline gt_ph_node_t *gt_ph_first(gt_pheap_t *heap)
+{
+	return heap->root;
+}
+
+static inline int gt_ph_empty(gt_pheap_t *heap)
+{
+	return !heap->root;
+}
+
+#endif /* GT_PHEAP_H_ */
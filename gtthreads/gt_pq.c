@@ -12,6 +12,8 @@
 #include "gt_tailq.h"
 #include "gt_scheduler_pcs.h"
 #include "gt_common.h"
+#include "gt_kthread.h"
+#include "gt_slab.h"
 
 /* set valid priorities and groups */
 /* returns the priority of the given uthread, if it is a valid value. Else
@@ -33,7 +35,7 @@ int pq_get_priority(uthread_t *uthread) {
 int pq_get_group_id(uthread_t *uthread) {
 	int group_id = uthread->attr->group_id;
 	int max_group_id = PQ_MIN_UTHREAD_GROUP + PQ_MAX_UTHREAD_GROUP_COUNT - 1;
-	if (group_id == UTHREAD_ATTR_PRIORITY_DEFAULT) {
+	if (group_id == UTHREAD_ATTR_GROUP_DEFAULT) {
 		group_id = PQ_DEFAULT_UTHREAD_GROUP;
 	} else if (group_id < PQ_MIN_UTHREAD_GROUP) {
 		group_id = PQ_MIN_UTHREAD_GROUP;
@@ -46,86 +48,111 @@ int pq_get_group_id(uthread_t *uthread) {
 
 /**********************************************************************/
 /* runqueue operations */
-static void __add_to_runqueue(runqueue_t *runq, pcs_uthread_t *u_elm);
-static void __rem_from_runqueue(runqueue_t *runq, pcs_uthread_t *u_elm);
+static prio_struct_t *__alloc_prio(runqueue_t *runq)
+{
+	prio_struct_t *prioq = gt_slab_alloc(runq->slab_heap, sizeof(*prioq));
+	prioq->group_words = 0;
+	for (int w = 0; w < PQ_GROUP_WORDS; w++) {
+		prioq->group_mask[w] = 0;
+		prioq->group_heads[w] = NULL;
+	}
+	return prioq;
+}
+
+static uthread_head_t *__alloc_group_heads(runqueue_t *runq)
+{
+	uthread_head_t *uheads = gt_slab_alloc(runq->slab_heap,
+	                                       PQ_GROUP_WORD_BITS
+	                                       * sizeof(*uheads));
+	for (int i = 0; i < PQ_GROUP_WORD_BITS; i++)
+		TAILQ_INIT(&uheads[i]);
+	return uheads;
+}
 
-/**********************************************************************/
-/* runqueue operations */
 static inline void __add_to_runqueue(runqueue_t *runq, pcs_uthread_t *u_elem)
 {
-	unsigned int uprio, ugroup;
-	uthread_head_t *uhead;
+	unsigned int uprio, ugroup, uword, ubit;
 
 	/* Find a position in the runq based on priority and group.
 	 * Update the masks. */
 	uprio = u_elem->priority;
 	ugroup = u_elem->group_id;
+	uword = ugroup / PQ_GROUP_WORD_BITS;
+	ubit = ugroup % PQ_GROUP_WORD_BITS;
+
+	prio_struct_t *prioq = runq->prio_array[uprio];
+	if (!prioq)
+		prioq = runq->prio_array[uprio] = __alloc_prio(runq);
+	if (!prioq->group_heads[uword])
+		prioq->group_heads[uword] = __alloc_group_heads(runq);
 
 	/* Insert at the tail */
-	uhead = &runq->prio_array[uprio].group[ugroup];
-	TAILQ_INSERT_TAIL(uhead, u_elem, uthread_runq);
+	TAILQ_INSERT_TAIL(&prioq->group_heads[uword][ubit], u_elem,
+	                  uthread_runq);
 
 	/* Update information */
-	if (!IS_BIT_SET(runq->prio_array[uprio].group_mask, ugroup))
-		SET_BIT(runq->prio_array[uprio].group_mask, ugroup);
-
+	SET_BIT(prioq->group_mask[uword], ubit);
+	SET_BIT(prioq->group_words, uword);
+	SET_BIT(runq->uthread_mask, uprio);
 	runq->uthread_tot++;
 
-	runq->uthread_prio_tot[uprio]++;
-	if (!IS_BIT_SET(runq->uthread_mask, uprio))
-		SET_BIT(runq->uthread_mask, uprio);
-
-	runq->uthread_group_tot[ugroup]++;
-	if (!IS_BIT_SET(runq->uthread_group_mask[ugroup], uprio))
-		SET_BIT(runq->uthread_group_mask[ugroup], uprio);
-
 	return;
 }
 
 static inline void __rem_from_runqueue(runqueue_t *runq,
                                        pcs_uthread_t *u_elem)
 {
-	unsigned int uprio, ugroup;
+	unsigned int uprio, ugroup, uword, ubit;
 	uthread_head_t *uhead;
 
 	/* Find a position in the runq based on priority and group.
 	 * Update the masks. */
 	uprio = u_elem->priority;
 	ugroup = u_elem->group_id;
+	uword = ugroup / PQ_GROUP_WORD_BITS;
+	ubit = ugroup % PQ_GROUP_WORD_BITS;
 
-
-	/* Insert at the tail */
-	uhead = &runq->prio_array[uprio].group[ugroup];
+	prio_struct_t *prioq = runq->prio_array[uprio];
+	uhead = &prioq->group_heads[uword][ubit];
 	TAILQ_REMOVE(uhead, u_elem, uthread_runq);
 
-	/* Update information */
-	if (TAILQ_EMPTY(uhead))
-		RESET_BIT(runq->prio_array[uprio].group_mask, ugroup);
+	/* Update information, from the group up as levels empty */
 	runq->uthread_tot--;
-
-	if (!(--(runq->uthread_prio_tot[uprio])))
+	if (!TAILQ_EMPTY(uhead))
+		return;
+	RESET_BIT(prioq->group_mask[uword], ubit);
+	if (prioq->group_mask[uword])
+		return;
+	RESET_BIT(prioq->group_words, uword);
+	if (!prioq->group_words)
 		RESET_BIT(runq->uthread_mask, uprio);
 
-	if (!(--(runq->uthread_group_tot[ugroup]))) {
-		assert(TAILQ_EMPTY(uhead));
-		RESET_BIT(runq->uthread_group_mask[ugroup], uprio);
-	}
-
 	return;
 }
 
 /**********************************************************************/
 /* Exported runqueue operations */
-extern void init_runqueue(runqueue_t *runq)
+extern void init_runqueue(runqueue_t *runq, struct gt_slab_heap *slab_heap)
 {
-	uthread_head_t *uhead;
-	int i, j;
-	/* Everything else is global, so already initialized to 0(correct init value) */
-	for (i = 0; i < PQ_MAX_UTHREAD_PRIORITY; i++) {
-		for (j = 0; j < PQ_MAX_UTHREAD_GROUP_COUNT; j++) {
-			uhead = &((runq)->prio_array[i].group[j]);
-			TAILQ_INIT(uhead);
-		}
+	runq->uthread_mask = 0;
+	runq->uthread_tot = 0;
+	runq->slab_heap = slab_heap;
+	for (int i = 0; i < PQ_UTHREAD_PRIORITY_COUNT; i++)
+		runq->prio_array[i] = NULL;
+	return;
+}
+
+extern void destroy_runqueue(runqueue_t *runq)
+{
+	for (int i = 0; i < PQ_UTHREAD_PRIORITY_COUNT; i++) {
+		prio_struct_t *prioq = runq->prio_array[i];
+		if (!prioq)
+			continue;
+		for (int w = 0; w < PQ_GROUP_WORDS; w++)
+			if (prioq->group_heads[w])
+				kthread_slab_free(prioq->group_heads[w]);
+		kthread_slab_free(prioq);
+		runq->prio_array[i] = NULL;
 	}
 	return;
 }
@@ -133,10 +160,8 @@ extern void init_runqueue(runqueue_t *runq)
 extern void add_to_runqueue(runqueue_t *runq, gt_spinlock_t *runq_lock,
                             pcs_uthread_t *u_elem)
 {
-	if (runq_lock) {
+	if (runq_lock)
 		gt_spin_lock(runq_lock);
-		runq_lock->holder = 0x02;
-	}
 	__add_to_runqueue(runq, u_elem);
 	if (runq_lock)
 		gt_spin_unlock(runq_lock);
@@ -146,10 +171,8 @@ extern void add_to_runqueue(runqueue_t *runq, gt_spinlock_t *runq_lock,
 extern void rem_from_runqueue(runqueue_t *runq, gt_spinlock_t *runq_lock,
                               pcs_uthread_t *u_elem)
 {
-	if (runq_lock) {
+	if (runq_lock)
 		gt_spin_lock(runq_lock);
-		runq_lock->holder = 0x03;
-	}
 	__rem_from_runqueue(runq, u_elem);
 	if (runq_lock)
 		gt_spin_unlock(runq_lock);
@@ -167,17 +190,50 @@ extern void switch_runqueue(runqueue_t *from_runq,
 	return;
 }
 
+extern pcs_uthread_t *peek_runqueue(runqueue_t *runq)
+{
+	unsigned int uprio, uword, ubit;
+	uprio = LOWEST_BIT_SET(runq->uthread_mask);
+	prio_struct_t *prioq = runq->prio_array[uprio];
+
+	assert(prioq->group_words);
+	uword = LOWEST_BIT_SET(prioq->group_words);
+	ubit = LOWEST_BIT_SET(prioq->group_mask[uword]);
+	return TAILQ_FIRST(&prioq->group_heads[uword][ubit]);
+}
+
+extern pcs_uthread_t *peek_runqueue_group(runqueue_t *runq, unsigned int group)
+{
+	unsigned int uword = group / PQ_GROUP_WORD_BITS;
+	unsigned int ubit = group % PQ_GROUP_WORD_BITS;
+	/* prio_structs live as long as the runq, so this is safe unlocked */
+	for (unsigned long mask = runq->uthread_mask; mask; mask &= mask - 1) {
+		prio_struct_t *prioq = runq->prio_array[LOWEST_BIT_SET(mask)];
+		if (IS_BIT_SET(prioq->group_mask[uword], ubit))
+			return TAILQ_FIRST(&prioq->group_heads[uword][ubit]);
+	}
+	return NULL;
+}
+
 /**********************************************************************/
 
-extern void kthread_init_runqueue(kthread_runqueue_t *kthread_runq)
+extern void kthread_init_runqueue(kthread_runqueue_t *kthread_runq,
+                                  struct gt_slab_heap *slab_heap)
 {
 	kthread_runq->active_runq = &(kthread_runq->runqueues[0]);
 	kthread_runq->expires_runq = &(kthread_runq->runqueues[1]);
 
-	gt_spinlock_init(&(kthread_runq->kthread_runqlock));
-	init_runqueue(kthread_runq->active_runq);
-	init_runqueue(kthread_runq->expires_runq);
+	gt_spinlock_init_named(&(kthread_runq->kthread_runqlock),
+	                       "kthread_runqlock");
+	init_runqueue(kthread_runq->active_runq, slab_heap);
+	init_runqueue(kthread_runq->expires_runq, slab_heap);
 
-	TAILQ_INIT(&(kthread_runq->zombie_uthreads));
+	return;
+}
+
+extern void kthread_destroy_runqueue(kthread_runqueue_t *kthread_runq)
+{
+	destroy_runqueue(&kthread_runq->runqueues[0]);
+	destroy_runqueue(&kthread_runq->runqueues[1]);
 	return;
 }
@@ -14,34 +14,38 @@
 typedef struct __kthread_context kthread_context_t;
 
 #define PQ_MIN_UTHREAD_PRIORITY 0
-#define PQ_MAX_UTHREAD_PRIORITY 32
+#define PQ_MAX_UTHREAD_PRIORITY 63
+#define PQ_UTHREAD_PRIORITY_COUNT (PQ_MAX_UTHREAD_PRIORITY + 1)
 #define PQ_DEFAULT_UTHREAD_PRIORITY 16
-#define PQ_MAX_UTHREAD_GROUP_COUNT 32
+#define PQ_MAX_UTHREAD_GROUP_COUNT 256
 #define PQ_MIN_UTHREAD_GROUP 0
 #define PQ_DEFAULT_UTHREAD_GROUP 0
+/* groups are mapped a 64-bit word at a time */
+#define PQ_GROUP_WORD_BITS 64
+#define PQ_GROUP_WORDS (PQ_MAX_UTHREAD_GROUP_COUNT / PQ_GROUP_WORD_BITS)
 
 TAILQ_HEAD(uthread_head, pcs_uthread);
 typedef struct uthread_head uthread_head_t;
 struct pcs_uthread;
+struct gt_slab_heap;
 
+/* The uthreads of one priority. A group's list head sits in the block of
+ * PQ_GROUP_WORD_BITS heads for its word, allocated when a uthread of one of
+ * those groups is first queued at this priority */
 typedef struct prio_struct {
-		unsigned int group_mask; /* mask(i) : groups with atleast one thread */
-		unsigned int reserved[3];
-
-		uthread_head_t group[PQ_MAX_UTHREAD_GROUP_COUNT]; /* array(i) : uthreads from uthread_group 'i' */
+		unsigned long group_words; /* bit(w) : group_mask[w] is not 0 */
+		unsigned long group_mask[PQ_GROUP_WORDS]; /* bit(g % 64) of word(g / 64) : group 'g' has a uthread */
+		uthread_head_t *group_heads[PQ_GROUP_WORDS]; /* array(w)[i] : uthreads from uthread_group '64w + i' */
 } prio_struct_t;
 
+/* A lookup is three tzcnts on the way down: priority, group word, group. Only
+ * the priorities ever queued here have a prio_struct */
 typedef struct runqueue {
-		unsigned int uthread_mask; /* mask : prio levels with atleast one uthread */
+		unsigned long uthread_mask; /* mask : prio levels with atleast one uthread */
 		unsigned int uthread_tot; /* cnt : Tot num of uthreads in the runq (all priorities) */
-		uthread_gid min_uthread_group; /* NOT USED : group (in the runqueue) with minimum uthreads (but GT 0) */
-
-		unsigned int uthread_prio_tot[PQ_MAX_UTHREAD_PRIORITY]; /* array(i) : Tot num of uthreads at priority 'i' */
-
-		unsigned int uthread_group_mask[PQ_MAX_UTHREAD_GROUP_COUNT]; /* array(i) : prio levels with atleast one uthread from uthread_group 'i' */
-		unsigned int uthread_group_tot[PQ_MAX_UTHREAD_GROUP_COUNT]; /* array(i) : Tot num of uthreads in uthread_group 'i' */
+		struct gt_slab_heap *slab_heap; /* the owning kthread's, for prio_array and heads */
 
-		prio_struct_t prio_array[PQ_MAX_UTHREAD_PRIORITY];
+		prio_struct_t *prio_array[PQ_UTHREAD_PRIORITY_COUNT]; /* array(i) : priority 'i', NULL until used */
 } runqueue_t;
 
 
@@ -54,35 +58,35 @@ int pq_get_priority(uthread_t *uthread);
 int pq_get_group_id(uthread_t *uthread);
 
 
-/* NOTE: kthread active/expires/zombie use the same link(uthread_runq) in uthread_struct.
- * This is perfectly fine since active/expires/zombie are mutually exclusive. */
+/* NOTE: kthread active/expires use the same link(uthread_runq) in uthread_struct.
+ * This is perfectly fine since active/expires are mutually exclusive. */
 
 /* NOTE: Each kthread simulates a virtual processor.
  * Since we are running only one uthread on a kthread
- * at any given time, we (typically) do not need a runqlock
- * when executing uthreads. But, runqlock is necessary to allow
- * a uthread_create from any kthread to post a uthread to
- * any kthread's runq.
- * There is not much performance penalty (only one additional check),
- * since we are using spinlocks. */
-
-/* NOTE: We can have locks at finer granularity than kthread_runqlock.
- * For instance, a lock for each queue. But, for the current design,
- * it will be an overkill. So, we go with one *GIANT* lock for the
- * entire kthread runqueue */
+ * at any given time, the kthread itself does almost all the work
+ * on its runqueues. A uthread_create on another kthread posts the
+ * new uthread to the PCS kthread's lock-free inbox instead (see
+ * gt_scheduler_pcs.h), which the owner drains into its active runq.
+ * kthread_runqlock is there for gang mode, where siblings gathering
+ * a group take uthreads off the runqueues while we run. It is one
+ * lock for both runqueues, and outside gang mode the owner doesn't
+ * take it: nothing else touches them. An idle sibling doesn't take
+ * work from us either; we hand it some through its inbox when we
+ * pick. */
 typedef struct __kthread_runqueue {
 		runqueue_t *active_runq;
 		runqueue_t *expires_runq;
 		gt_spinlock_t kthread_runqlock;
 
 		unsigned int reserved0;
-		uthread_head_t zombie_uthreads;
 
 		runqueue_t runqueues[2];
 } kthread_runqueue_t;
 
-/* only lock protected versions are exported */
-extern void init_runqueue(runqueue_t *runq);
+/* only lock protected versions are exported. Adding may allocate from the
+ * runq's slab heap, so only its owning kthread adds to it */
+extern void init_runqueue(runqueue_t *runq, struct gt_slab_heap *slab_heap);
+extern void destroy_runqueue(runqueue_t *runq);
 extern void add_to_runqueue(runqueue_t *runq, gt_spinlock_t *runq_lock,
                             struct pcs_uthread *u_elem);
 extern void rem_from_runqueue(runqueue_t *runq, gt_spinlock_t *runq_lock,
@@ -91,8 +95,19 @@ extern void switch_runqueue(runqueue_t *from_runq, gt_spinlock_t *from_runqlock,
                             runqueue_t *to_runq, gt_spinlock_t *to_runqlock,
                             struct pcs_uthread *u_elem);
 
-/* kthread runqueue */
-extern void kthread_init_runqueue(kthread_runqueue_t *kthread_runq);
+/* returns the first uthread in the highest priority bucket of a non-empty
+ * runq, without removing it */
+extern struct pcs_uthread *peek_runqueue(runqueue_t *runq);
+
+/* returns the first uthread of `group` in the highest priority bucket that
+ * has one, NULL if there is none. Without the runq's lock, only a hint */
+extern struct pcs_uthread *peek_runqueue_group(runqueue_t *runq,
+                                               unsigned int group);
+
+/* kthread runqueue. `slab_heap` is the calling kthread's, which owns it */
+extern void kthread_init_runqueue(kthread_runqueue_t *kthread_runq,
+                                  struct gt_slab_heap *slab_heap);
+extern void kthread_destroy_runqueue(kthread_runqueue_t *kthread_runq);
 
 /* Find the highest priority uthread.
  * Called by kthread handling VTALRM. */
@@ -0,0 +1,74 @@
+/*
+ * gt_radixheap.c
+ */
+
+#include "gt_radixheap.h"
+
+void gt_rh_init(gt_radixheap_t *heap)
+{
+	heap->last = 0;
+	heap->mask = 0;
+	for (int i = 0; i < GT_RH_BUCKETS; i++)
+		heap->buckets[i] = NULL;
+}
+
+static inline unsigned int gt_rh_bucket(unsigned long last, unsigned long key)
+{
+	return key == last ? 0 : 8 * sizeof(key) - __builtin_clzl(key ^ last);
+}
+
+static inline void gt_rh_push(gt_radixheap_t *heap, gt_rh_node_t *node)
+{
+	unsigned int i = gt_rh_bucket(heap->last, node->key);
+	node->next = heap->buckets[i];
+	heap->buckets[i] = node;
+	if (i)
+		heap->mask |= 1UL << (i - 1);
+}
+
+void gt_rh_insert(gt_radixheap_t *heap, gt_rh_node_t *node)
+{
+	if (gt_rh_empty(heap))
+		heap->last = node->key; /* empty: any key will do */
+	else if (node->key < heap->last)
+		node->key = heap->last;
+	gt_rh_push(heap, node);
+}
+
+/* moves `last` up to the minimum, so that bucket 0 holds it: everything in the
+ * lowest non-empty bucket now differs from it in a lower bit, so goes to a
+ * lower bucket */
+static void gt_rh_settle(gt_radixheap_t *heap)
+{
+	if (heap->buckets[0] || !heap->mask)
+		return;
+	unsigned int i = __builtin_ctzl(heap->mask) + 1;
+	gt_rh_node_t *n = heap->buckets[i], *next;
+	unsigned long min = n->key;
+	for (; n; n = n->next)
+		if (n->key < min)
+			min = n->key;
+	heap->last = min;
+	n = heap->buckets[i];
+	heap->buckets[i] = NULL;
+	heap->mask &= ~(1UL << (i - 1));
+	for (; n; n = next) {
+		next = n->next;
+		gt_rh_push(heap, n);
+	}
+}
+
+gt_rh_node_t *gt_rh_first(gt_radixheap_t *heap)
+{
+	gt_rh_settle(heap);
+	return heap->buckets[0];
+}
+
+gt_rh_node_t *gt_rh_delete_min(gt_radixheap_t *heap)
+{
+	gt_rh_settle(heap);
+	gt_rh_node_t *min = heap->buckets[0];
+	if (min)
+		heap->buckets[0] = min->next;
+	return min;
+}
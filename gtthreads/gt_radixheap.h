@@ -0,0 +1,48 @@
+/*
+ * gt_radixheap.h
+ *
+ * Intrusive monotone radix heap keyed on an unsigned long, one of the CFS
+ * timelines (see gt_timeline.h). Nodes sit in buckets by the highest bit in
+ * which their key differs from `last`, the key last taken out. Taking out the
+ * minimum redistributes one bucket into lower ones, so each node moves at most
+ * once per bit: amortized O(log range), with no comparisons on insert.
+ *
+ * It is monotone: a key smaller than `last` is raised to `last` on insert,
+ * the way CFS places a uthread no earlier than min_vruntime.
+ */
+
+#ifndef GT_RADIXHEAP_H_
+#define GT_RADIXHEAP_H_
+
+#include <stddef.h>
+
+/* bucket 0 holds keys equal to `last`, bucket i those differing from it
+ * first in bit i-1 */
+#define GT_RH_BUCKETS (8 * sizeof(unsigned long) + 1)
+
+typedef struct gt_rh_node {
+	struct gt_rh_node *next;
+	unsigned long key;
+} gt_rh_node_t;
+
+typedef struct gt_radixheap {
+	unsigned long last;
+	unsigned long mask;	/* bit i-1 set: bucket i is not empty */
+	gt_rh_node_t *buckets[GT_RH_BUCKETS];
+} gt_radixheap_t;
+
+void gt_rh_init(gt_radixheap_t *heap);
+void gt_rh_insert(gt_radixheap_t *heap, gt_rh_node_t *node);
+/* removes and returns the node with the smallest key, NULL if empty */
+gt_rh_node_t *gt_rh_delete_min(gt_radixheap_t *heap);
+/* the node with the smallest key, NULL if the heap is empty; the next
+ * gt_rh_delete_min() takes out this very node. Does the redistributing that
+ * gt_rh_delete_min() would have, so costs the same */
+gt_rh_node_t *gt_rh_first(gt_radixheap_t *heap);
+
+static inline int gt_rh_empty(gt_radixheap_t *heap)
+{
+	return !heap->buckets[0] && !heap->mask;
+}
+
+#endif /* GT_RADIXHEAP_H_ */
@@ -0,0 +1,234 @@
+/*
+ * gt_rbtree.c
+ *
+ * The algorithms are those of _Introduction_To_Algorithms_, with NULL for the
+ * leaves instead of a sentinel.
+ */
+
+#include "gt_rbtree.h"
+
+void gt_rb_init(gt_rb_tree_t *tree)
+{
+	tree->root = NULL;
+	tree->leftmost = NULL;
+}
+
+static inline int gt_rb_is_red(gt_rb_node_t *node)
+{
+	return node && node->red;
+}
+
+/* puts `new` where `old` hangs from its parent */
+static inline void gt_rb_replace_child(gt_rb_tree_t *tree, gt_rb_node_t *old,
+                                       gt_rb_node_t *new)
+{
+	if (!old->parent)
+		tree->root = new;
+	else if (old == old->parent->left)
+		old->parent->left = new;
+	else
+		old->parent->right = new;
+	if (new)
+		new->parent = old->parent;
+}
+
+static void gt_rb_rotate_left(gt_rb_tree_t *tree, gt_rb_node_t *x)
+{
+	gt_rb_node_t *y = x->right;
+	x->right = y->left;
+	if (y->left)
+		y->left->parent = x;
+	gt_rb_replace_child(tree, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+static void gt_rb_rotate_right(gt_rb_tree_t *tree, gt_rb_node_t *x)
+{
+	gt_rb_node_t *y = x->left;
+	x->left = y->right;
+	if (y->right)
+		y->right->parent = x;
+	gt_rb_replace_child(tree, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+void gt_rb_insert(gt_rb_tree_t *tree, gt_rb_node_t *z)
+{
+	gt_rb_node_t *parent = NULL;
+	gt_rb_node_t **link = &tree->root;
+	int leftmost = 1;
+	while (*link) {
+		parent = *link;
+		if (z->key < parent->key) {
+			link = &parent->left;
+		} else {
+			link = &parent->right;
+			leftmost = 0;
+		}
+	}
+	z->parent = parent;
+	z->left = z->right = NULL;
+	z->red = 1;
+	*link = z;
+	if (leftmost)
+		tree->leftmost = z;
+
+	gt_rb_node_t *p, *g, *u;
+	while ((p = z->parent) && p->red) {
+		g = p->parent; /* p is red, so not the root */
+		if (p == g->left) {
+			u = g->right;
+			if (gt_rb_is_red(u)) {
+				p->red = u->red = 0;
+				g->red = 1;
+				z = g;
+				continue;
+			}
+			if (z == p->right) {
+				gt_rb_rotate_left(tree, p);
+				z = p;
+				p = z->parent;
+			}
+			p->red = 0;
+			g->red = 1;
+			gt_rb_rotate_right(tree, g);
+		} else {
+			u = g->left;
+			if (gt_rb_is_red(u)) {
+				p->red = u->red = 0;
+				g->red = 1;
+				z = g;
+				continue;
+			}
+			if (z == p->left) {
+				gt_rb_rotate_right(tree, p);
+				z = p;
+				p = z->parent;
+			}
+			p->red = 0;
+			g->red = 1;
+			gt_rb_rotate_left(tree, g);
+		}
+	}
+	tree->root->red = 0;
+}
+
+gt_rb_node_t *gt_rb_next(gt_rb_node_t *node)
+{
+	if (node->right) {
+		node = node->right;
+		while (node->left)
+			node = node->left;
+		return node;
+	}
+	while (node->parent && node == node->parent->right)
+		node = node->parent;
+	return node->parent;
+}
+
+/* restores the colours after a black node was taken out above `x`, which may
+ * be NULL, so its parent comes separately */
+static void gt_rb_erase_fixup(gt_rb_tree_t *tree, gt_rb_node_t *x,
+                              gt_rb_node_t *parent)
+{
+	gt_rb_node_t *w;
+	while (x != tree->root && !gt_rb_is_red(x)) {
+		/* x is one black short, so its sibling w is never NULL */
+		if (x == parent->left) {
+			w = parent->right;
+			if (w->red) {
+				w->red = 0;
+				parent->red = 1;
+				gt_rb_rotate_left(tree, parent);
+				w = parent->right;
+			}
+			if (!gt_rb_is_red(w->left) && !gt_rb_is_red(w->right)) {
+				w->red = 1;
+				x = parent;
+				parent = x->parent;
+				continue;
+			}
+			if (!gt_rb_is_red(w->right)) {
+				w->left->red = 0;
+				w->red = 1;
+				gt_rb_rotate_right(tree, w);
+				w = parent->right;
+			}
+			w->red = parent->red;
+			parent->red = 0;
+			w->right->red = 0;
+			gt_rb_rotate_left(tree, parent);
+		} else {
+			w = parent->left;
+			if (w->red) {
+				w->red = 0;
+				parent->red = 1;
+				gt_rb_rotate_right(tree, parent);
+				w = parent->left;
+			}
+			if (!gt_rb_is_red(w->left) && !gt_rb_is_red(w->right)) {
+				w->red = 1;
+				x = parent;
+				parent = x->parent;
+				continue;
+			}
+			if (!gt_rb_is_red(w->left)) {
+				w->right->red = 0;
+				w->red = 1;
+				gt_rb_rotate_left(tree, w);
+				w = parent->left;
+			}
+			w->red = parent->red;
+			parent->red = 0;
+			w->left->red = 0;
+			gt_rb_rotate_right(tree, parent);
+		}
+		x = tree->root;
+		break;
+	}
+	if (x)
+		x->red = 0;
+}
+
+void gt_rb_erase(gt_rb_tree_t *tree, gt_rb_node_t *z)
+{
+	gt_rb_node_t *x, *parent;
+	int removed_red = z->red;
+
+	if (tree->leftmost == z)
+		tree->leftmost = gt_rb_next(z);
+
+	if (!z->left) {
+		x = z->right;
+		parent = z->parent;
+		gt_rb_replace_child(tree, z, x);
+	} else if (!z->right) {
+		x = z->left;
+		parent = z->parent;
+		gt_rb_replace_child(tree, z, x);
+	} else {
+		/* z's successor y takes z's place, and y's right child y's */
+		gt_rb_node_t *y = z->right;
+		while (y->left)
+			y = y->left;
+		removed_red = y->red;
+		x = y->right;
+		if (y->parent == z) {
+			parent = y;
+		} else {
+			parent = y->parent;
+			gt_rb_replace_child(tree, y, x);
+			y->right = z->right;
+			y->right->parent = y;
+		}
+		gt_rb_replace_child(tree, z, y);
+		y->left = z->left;
+		y->left->parent = y;
+		y->red = z->red;
+	}
+
+	if (!removed_red)
+		gt_rb_erase_fixup(tree, x, parent);
+}
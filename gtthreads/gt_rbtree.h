@@ -0,0 +1,61 @@
+/*
+ * gt_rbtree.h
+ *
+ * Intrusive red-black tree keyed on an unsigned long, for the CFS timeline.
+ * The node lives inside the object it orders (get back to the object with
+ * gt_rb_entry()), so inserting and removing never allocate, and keys are
+ * compared inline. Equal keys go after the ones already in the tree. The
+ * leftmost node is cached, so the minimum is one load away.
+ */
+
+#ifndef GT_RBTREE_H_
+#define GT_RBTREE_H_
+
+#include <stddef.h>
+
+typedef struct gt_rb_node {
+	struct gt_rb_node *parent;
+	struct gt_rb_node *left;
+	struct gt_rb_node *right;
+	unsigned long key;	/* set before inserting; don't change while in */
+	int red;
+} gt_rb_node_t;
+
+typedef struct gt_rb_tree {
+	gt_rb_node_t *root;
+	gt_rb_node_t *leftmost;
+} gt_rb_tree_t;
+
+/* the object of `type` whose `member` is the node `ptr` */
+#define gt_rb_entry(ptr, type, member) \
+	((type *) ((char *) (ptr) - offsetof(type, member)))
+
+#define GT_RB_TREE_INITIALIZER { NULL, NULL }
+
+void gt_rb_init(gt_rb_tree_t *tree);
+void gt_rb_insert(gt_rb_tree_t *tree, gt_rb_node_t *node);
+void gt_rb_erase(gt_rb_tree_t *tree, gt_rb_node_t *node);
+/* the node after `node` in key order, NULL at the end */
+gt_rb_node_t *gt_rb_next(gt_rb_node_t *node);
+
+/* the node with the smallest key, NULL if the tree is empty */
+static inline gt_rb_node_t *gt_rb_first(gt_rb_tree_t *tree)
+{
+	return tree->leftmost;
+}
+
+static inline int gt_rb_empty(gt_rb_tree_t *tree)
+{
+	return !tree->root;
+}
+
+/* removes and returns the node with the smallest key, NULL if empty */
+static inline gt_rb_node_t *gt_rb_delete_min(gt_rb_tree_t *tree)
+{
+	gt_rb_node_t *min = tree->leftmost;
+	if (min)
+		gt_rb_erase(tree, min);
+	return min;
+}
+
+#endif /* GT_RBTREE_H_ */
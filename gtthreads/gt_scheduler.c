@@ -4,12 +4,12 @@
  */
 
 #include <unistd.h>
-#include <ucontext.h>
 
 #include "gt_scheduler.h"
+#include "gt_clock.h"
 #include "gt_kthread.h"
 #include "gt_uthread.h"
-#include "gt_uthread.h"
+#include "gt_context.h"
 #include "gt_spinlock.h"
 #include "gt_common.h"
 #include "gt_signal.h"
@@ -22,30 +22,35 @@ scheduler_t scheduler;
 void schedule(void)
 {
 	kthread_t *k_ctx = kthread_current_kthread();
+	k_ctx->in_scheduler = 1;
 	checkpoint("k%d: Scheduling", k_ctx->cpuid);
+	uthread_t *prev_uthread = k_ctx->current_uthread;
+	/* the one clock read of the switch: see uthread_slice_begin() */
+	k_ctx->switch_ns = gt_clock_ns();
+	if (prev_uthread)
+		uthread_slice_end(prev_uthread, k_ctx->switch_ns);
 	scheduler.preempt_current_uthread(k_ctx);
-	uthread_t *next_uthread = scheduler.pick_next_uthread(k_ctx);
-	if (next_uthread == NULL) {
-		/* we're done with all our uhreads */
-		checkpoint("k%d: NULL next_uthread", k_ctx->cpuid);
-		checkpoint("k%d: Setting state to DONE, wait for more uthreads",
-			   k_ctx->cpuid);
-		k_ctx->state = KTHREAD_DONE;
-		kthread_wait_for_uthread(k_ctx);
-		return;
-	}
+	if (prev_uthread && prev_uthread->state == UTHREAD_DONE)
+		uthread_reap(prev_uthread, k_ctx);
+	uthread_t *next_uthread = kthread_wait_for_uthread(k_ctx);
+	/* a uthread gets its stack when it first runs, from the pool of the
+	 * kthread running it, where finished uthreads leave theirs. Creating
+	 * it from the application thread would always map a fresh one */
+	if (!next_uthread->stack)
+		uthread_makecontext(next_uthread, k_ctx);
 
 	checkpoint("k%d: u%d: Resuming uthread", k_ctx->cpuid,
 		   next_uthread->tid);
 	k_ctx->current_uthread = next_uthread;
+	uthread_slice_begin(next_uthread, k_ctx->switch_ns);
 	scheduler.resume_uthread(k_ctx); // possibly sets timer
-	setcontext(&next_uthread->context);
+	gt_context_set(&next_uthread->context);
 }
 
 void scheduler_init(scheduler_t *scheduler, scheduler_type_t sched_type,
                     int lwp_count)
 {
-	gt_spinlock_init(&scheduler->lock);
+	gt_spinlock_init_named(&scheduler->lock, "scheduler");
 	scheduler_switch(scheduler, sched_type, lwp_count);
 	return;
 }
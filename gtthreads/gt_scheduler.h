@@ -34,6 +34,12 @@ typedef void (*kthread_init_t)(struct kthread *);
 /* called after the creation of every new uthread. Should somehow assign the uthread to a kthread  and returns it */
 typedef struct kthread *(*uthread_init_t)(struct uthread *);
 
+/* optional: uthread_init for a batch of `count` new uthreads at once, putting
+ * the kthread each was assigned to in `kthreads`. Should take each of its
+ * locks once for the whole batch */
+typedef void (*uthread_init_many_t)(struct uthread **uthreads, int count,
+                                    struct kthread **kthreads);
+
 /* preements current uthread and returns it. If current uthread is DONE or NULL, returns NULL */
 typedef struct uthread *(*preempt_current_uthread_t)(struct kthread *);
 
@@ -43,17 +49,23 @@ typedef struct uthread *(*pick_next_uthread_t)(struct kthread *);
 /* takes care of last minute details before a the kthread's "current" uthread is resumed (e.g., setting any timers */
 typedef void (*resume_uthread_t)(struct kthread *);
 
+/* frees the scheduler's data for a DONE uthread, after preempt_current_uthread
+ * has seen it finish. Runs in schedule(), so must not block */
+typedef void (*reap_uthread_t)(struct kthread *, struct uthread *);
+
 typedef struct scheduler {
 	kthread_init_t kthread_init;
 	uthread_init_t uthread_init;
+	uthread_init_many_t uthread_init_many;
 	preempt_current_uthread_t preempt_current_uthread;
 	pick_next_uthread_t pick_next_uthread;
 	resume_uthread_t resume_uthread;
+	reap_uthread_t reap_uthread;
 
 	gt_spinlock_t lock;
 	sched_data_t data;
 } scheduler_t;
-
+
 /* initializes the above data structure for the specific scheduler type */
 void sched_type_scheduler_init(scheduler_type_t scheduler_type, int lwp_count);
 
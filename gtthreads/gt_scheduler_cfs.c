@@ -15,11 +15,50 @@
 #include "gt_kthread.h"
 #include "gt_common.h"
 #include "gt_spinlock.h"
-#include "rb_tree/red_black_tree.h"
+#include "gt_timeline.h"
 
+/* uthread priorities are nice levels shifted up by 20, so lower runs more */
+#define CFS_MIN_PRIORITY 0
+#define CFS_MAX_PRIORITY 39
 #define CFS_DEFAULT_PRIORITY 20
+/* the weight of CFS_DEFAULT_PRIORITY, whose vruntime runs at wall speed */
+#define CFS_NICE_0_WEIGHT 1024
+/* uthread groups; higher ids share the last one */
+#define CFS_GROUP_COUNT 32
+#define CFS_DEFAULT_GROUP 0
 #define CFS_DEFAULT_LATENCY_us 40000 /* 40 ms */
 #define CFS_MIN_GRANULARITY_us 20000 /* 20 ms */
+/* how often a busy kthread looks for a sibling to pull uthreads from. An idle
+ * one looks when it is unparked, which a busy one with uthreads waiting does
+ * when it picks (see cfs_wake_idle_sibling()) */
+#define CFS_BALANCE_INTERVAL_us 50000 /* 50 ms */
+/* most uthreads moved by one pull */
+#define CFS_MIGRATE_BATCH 16
+
+/* Weight of each priority, as in Linux: every step is worth about 10% of cpu
+ * share against a neighbour, and cfs_prio_to_weight[20] is CFS_NICE_0_WEIGHT */
+static const unsigned int cfs_prio_to_weight[CFS_MAX_PRIORITY + 1] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	9548, 7620, 6100, 4904, 3906,
+	3121, 2501, 1991, 1586, 1277,
+	1024, 820, 655, 526, 423,
+	335, 272, 215, 172, 137,
+	110, 87, 70, 56, 45,
+	36, 29, 23, 18, 15,
+};
+
+/* 2^32 / cfs_prio_to_weight[], so scaling a slice by 1/weight is a multiply */
+static const unsigned int cfs_prio_to_wmult[CFS_MAX_PRIORITY + 1] = {
+	48388, 59856, 76040, 92818, 118348,
+	147320, 184698, 229616, 287308, 360437,
+	449829, 563644, 704093, 875809, 1099582,
+	1376151, 1717300, 2157191, 2708050, 3363326,
+	4194304, 5237765, 6557202, 8165337, 10153587,
+	12820798, 15790321, 19976592, 24970740, 31350126,
+	39045157, 49367440, 61356676, 76695844, 95443717,
+	119304647, 148102320, 186737708, 238609294, 286331153,
+};
 
 /* global singleton scheduler */
 extern scheduler_t scheduler;
@@ -30,20 +69,41 @@ extern scheduler_t scheduler;
 typedef struct cfs_uthread {
 	struct uthread *uthread;
 	long unsigned vruntime;
-	unsigned priority;
-	long unsigned key; // key for rb tree, set to vruntime - min_vruntime
-	rb_red_blk_node *node;
+	unsigned int weight;	// cfs_prio_to_weight[] of its priority
+	unsigned int wmult;	// and cfs_prio_to_wmult[]
+	unsigned int group_id;
+	gt_timeline_node_t node; // keyed on vruntime, in its group's timeline
 } cfs_uthread_t;
 
+/* A group's share of one kthread. The kthread's timeline orders the groups
+ * waiting to run, and each group's timeline its own uthreads, so the cpu is
+ * split evenly among the groups first and by weight within each. A group with
+ * uthreads on the kthread is either waiting in the timeline or running */
+typedef struct cfs_group {
+	gt_timeline_node_t node; // keyed on vruntime, in the kthread's timeline
+	gt_timeline_t timeline;
+	long unsigned vruntime; // the cpu its uthreads had here, in ns
+	long unsigned min_vruntime; // of its uthreads
+	long unsigned load; // sum of weights of its uthreads here
+	int cfs_uthread_count; // of its uthreads here, running or not
+} cfs_group_t;
+
 typedef struct cfs_kthread {
 	gt_spinlock_t lock;
 	struct kthread *k_ctx;
 	cfs_uthread_t *current_cfs_uthread;
-	rb_red_blk_tree *tree;
+	gt_timeline_t timeline; // of waiting groups
 	int cfs_uthread_count;
+	int group_count; // groups with uthreads here
 	long unsigned latency; // epoch length
-	long unsigned min_vruntime;
-	float load; // sum of priorities of all tasks on kthread
+	long unsigned min_vruntime; // of the groups
+	long unsigned load; // sum of weights of all tasks on kthread
+	long unsigned next_balance; // CLOCK_MONOTONIC us of the next pull
+	/* placed here by cfs_uthread_init_many() but not added yet. Under
+	 * cfs_data->lock */
+	long unsigned planned_load;
+	int planned_count;
+	cfs_group_t groups[CFS_GROUP_COUNT];
 } cfs_kthread_t;
 
 /* global cfs data */
@@ -51,7 +111,7 @@ typedef struct cfs_data {
 	gt_spinlock_t lock;
 	int cfs_kthread_count;
 	cfs_kthread_t *cfs_kthreads;	// array, indexed by cpuid
-	unsigned last_cpu_assiged; // used for RR cpu asignment
+	unsigned last_cpu_assiged; // rotates placement among equal loads
 } cfs_data_t;
 
 /* returns the corresponding pcs_kthread_t for the given kthread_t */
@@ -61,31 +121,125 @@ static inline cfs_kthread_t *cfs_get_kthread(kthread_t *k_ctx)
 	return &cfs_data->cfs_kthreads[k_ctx->cpuid];
 }
 
-/* converts a timeval to integral microseconds */
-static inline unsigned long cfs_tv2us(struct timeval *tv)
+/* CLOCK_MONOTONIC in microseconds */
+static inline unsigned long cfs_now_us(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static inline long unsigned max(long unsigned a, long unsigned b)
+{
+	return a > b ? a : b;
+}
+
+/* the epoch grows with the uthreads on the kthread, so each still gets its
+ * minimum granularity */
+static inline void cfs_update_latency(cfs_kthread_t *cfs_kthread)
 {
-	return (tv->tv_sec * 1000000) + tv->tv_usec;
+	cfs_kthread->latency =
+	        max(CFS_DEFAULT_LATENCY_us,
+	            cfs_kthread->cfs_uthread_count * CFS_MIN_GRANULARITY_us);
 }
 
-/* converts an integer in microseconds to a struct timeval */
-static inline void cfs_us2tv(unsigned long us, struct timeval *tv)
+/* the uthread's priority, clamped to the CFS range */
+static unsigned int cfs_get_priority(uthread_t *uthread)
 {
-	tv->tv_sec = us / 1000000;
-	tv->tv_usec = us % 1000000;
+	int priority = uthread->attr->priority;
+	if (priority == UTHREAD_ATTR_PRIORITY_DEFAULT)
+		return CFS_DEFAULT_PRIORITY;
+	if (priority < CFS_MIN_PRIORITY)
+		return CFS_MIN_PRIORITY;
+	if (priority > CFS_MAX_PRIORITY)
+		return CFS_MAX_PRIORITY;
+	return priority;
 }
 
-/* calculates the timeslice from vruntime and the load on the cpu */
-static void cfs_calculate_timeslice(cfs_kthread_t *cfs_kthread,
-                                    struct timeval *timeslice)
+/* the uthread's group, clamped to the CFS range */
+static unsigned int cfs_get_group_id(uthread_t *uthread)
+{
+	uthread_gid group_id = uthread->attr->group_id;
+	if (group_id == UTHREAD_ATTR_GROUP_DEFAULT)
+		return CFS_DEFAULT_GROUP;
+	if (group_id < 0)
+		return 0;
+	if (group_id >= CFS_GROUP_COUNT)
+		return CFS_GROUP_COUNT - 1;
+	return group_id;
+}
+
+static inline cfs_group_t *cfs_get_group(cfs_kthread_t *cfs_kthread,
+                                         cfs_uthread_t *cfs_uthread)
+{
+	return &cfs_kthread->groups[cfs_uthread->group_id];
+}
+
+/* calculates the timeslice, in microseconds: the group's even share of the
+ * epoch, and the uthread's weight's share of that, but never less than
+ * CFS_MIN_GRANULARITY_us. A light uthread among heavy ones would otherwise
+ * get a few us, or 0, which would stop the timer */
+static unsigned long cfs_calculate_timeslice(cfs_kthread_t *cfs_kthread)
 {
 	cfs_uthread_t *cfs_uthread = cfs_kthread->current_cfs_uthread;
-	unsigned long timeslice_us = cfs_kthread->latency
-	        * (cfs_uthread->priority / cfs_kthread->load);
-	cfs_us2tv(timeslice_us, timeslice);
+	cfs_group_t *group = cfs_get_group(cfs_kthread, cfs_uthread);
+	return max(CFS_MIN_GRANULARITY_us,
+	           cfs_kthread->latency * cfs_uthread->weight
+	           / (group->load * cfs_kthread->group_count));
+}
+
+/* Adds a uthread arriving on the kthread to its group's timeline, `lag` ns of
+ * vruntime behind the group's first. A group that had no uthreads here starts
+ * level with the first group to run, so that time away earns no credit.
+ * Called with the kthread's lock held */
+static void cfs_add_uthread(cfs_kthread_t *cfs_kthread,
+                            cfs_uthread_t *cfs_uthread, long unsigned lag)
+{
+	cfs_group_t *group = cfs_get_group(cfs_kthread, cfs_uthread);
+	cfs_uthread->vruntime = group->min_vruntime + lag;
+	cfs_uthread->node.key = cfs_uthread->vruntime;
+	gt_timeline_insert(&group->timeline, &cfs_uthread->node);
+	group->load += cfs_uthread->weight;
+	cfs_kthread->load += cfs_uthread->weight;
+	cfs_kthread->cfs_uthread_count++;
+	cfs_update_latency(cfs_kthread);
+
+	if (!group->cfs_uthread_count++) {
+		cfs_kthread->group_count++;
+		group->vruntime = cfs_kthread->min_vruntime;
+		group->node.key = group->vruntime;
+		gt_timeline_insert(&cfs_kthread->timeline, &group->node);
+	}
+}
+
+/* takes the waiting uthread that would run next off the kthread, which must
+ * have one, and returns it with its lag behind its group's first. Called with
+ * the kthread's lock held */
+static cfs_uthread_t *cfs_remove_first_uthread(cfs_kthread_t *cfs_kthread,
+                                               long unsigned *lag)
+{
+	cfs_group_t *group = gt_timeline_entry(
+	        gt_timeline_first(&cfs_kthread->timeline), cfs_group_t, node);
+	cfs_uthread_t *cfs_uthread = gt_timeline_entry(
+	        gt_timeline_delete_min(&group->timeline), cfs_uthread_t, node);
+	*lag = cfs_uthread->vruntime > group->min_vruntime
+	        ? cfs_uthread->vruntime - group->min_vruntime : 0;
+	group->load -= cfs_uthread->weight;
+	cfs_kthread->load -= cfs_uthread->weight;
+	cfs_kthread->cfs_uthread_count--;
+	cfs_update_latency(cfs_kthread);
+
+	if (!--group->cfs_uthread_count)
+		cfs_kthread->group_count--;
+	/* a waiting group has a waiting uthread */
+	if (gt_timeline_empty(&group->timeline))
+		gt_timeline_delete_min(&cfs_kthread->timeline);
+	return cfs_uthread;
 }
 
 /* called right before current uthread resumes execution. should set a timer to ensure
- * that we get back to scheduling again.
+ * that we get back to scheduling again. With nothing else on the timeline, the
+ * timer is stopped instead.
  */
 void cfs_resume_uthread(kthread_t *k_ctx)
 {
@@ -94,28 +248,112 @@ void cfs_resume_uthread(kthread_t *k_ctx)
 	           k_ctx->cpuid, k_ctx->current_uthread->tid);
 	k_ctx->current_uthread->state = UTHREAD_RUNNING;
 
-	struct itimerval timeslice = {
-	        .it_interval = {
-	                0, 0 }  // no repeat
-	};
-
 	cfs_kthread_t *cfs_kthread = cfs_get_kthread(k_ctx);
-	cfs_calculate_timeslice(cfs_kthread, &timeslice.it_value);
-
-	if (setitimer(ITIMER_VIRTUAL, &timeslice, NULL)) // ignore old timer
-		fail_perror("setitimer");
+	cfs_group_t *group = cfs_get_group(cfs_kthread,
+	                                   cfs_kthread->current_cfs_uthread);
+	kthread_tickless_prepare(k_ctx);
+	if (!gt_timeline_empty(&cfs_kthread->timeline)
+	    || !gt_timeline_empty(&group->timeline))
+		kthread_set_timeslice(k_ctx,
+		                      cfs_calculate_timeslice(cfs_kthread));
+	else
+		kthread_set_timeslice(k_ctx, 0);
 	return;
 }
 
+/* Moves waiting uthreads from the most loaded sibling to `cfs_kthread`, until
+ * the two loads are about even. The sibling's next ones to run go, since they
+ * have waited longest. A uthread keeps its vruntime's distance from its
+ * group's min_vruntime, so it is neither ahead of nor behind its new
+ * neighbours by what the two kthreads' clocks differ */
+static void cfs_pull_uthreads(cfs_kthread_t *cfs_kthread)
+{
+	cfs_data_t *cfs_data = SCHED_DATA;
+	cfs_kthread_t *busiest = NULL;
+	long unsigned most = cfs_kthread->load;
+	/* unlocked loads are good enough to choose by */
+	for (int i = 0; i < cfs_data->cfs_kthread_count; i++) {
+		cfs_kthread_t *sibling = &cfs_data->cfs_kthreads[i];
+		if (sibling != cfs_kthread && sibling->load > most
+		    && !gt_timeline_empty(&sibling->timeline)) {
+			most = sibling->load;
+			busiest = sibling;
+		}
+	}
+	if (!busiest)
+		return;
+
+	cfs_uthread_t *moved[CFS_MIGRATE_BATCH];
+	long unsigned lag[CFS_MIGRATE_BATCH];
+	int count = 0;
+	gt_spin_lock(&busiest->lock);
+	long imbalance = ((long) busiest->load - (long) cfs_kthread->load) / 2;
+	gt_timeline_node_t *min;
+	while (count < CFS_MIGRATE_BATCH
+	       && (min = gt_timeline_first(&busiest->timeline))) {
+		cfs_group_t *group = gt_timeline_entry(min, cfs_group_t, node);
+		cfs_uthread_t *cfs_uthread = gt_timeline_entry(
+		        gt_timeline_first(&group->timeline), cfs_uthread_t,
+		        node);
+		if ((long) cfs_uthread->weight > imbalance)
+			break;
+		imbalance -= cfs_uthread->weight;
+		moved[count] = cfs_remove_first_uthread(busiest, &lag[count]);
+		count++;
+	}
+	gt_spin_unlock(&busiest->lock);
+	if (!count)
+		return;
+
+	checkpoint("k%d: CFS: pulled %d uthreads from k%d",
+	           cfs_kthread->k_ctx->cpuid, count, busiest->k_ctx->cpuid);
+	gt_spin_lock(&cfs_kthread->lock);
+	for (int i = 0; i < count; i++)
+		cfs_add_uthread(cfs_kthread, moved[i], lag[i]);
+	gt_spin_unlock(&cfs_kthread->lock);
+}
+
+/* Unparks an idle sibling, which then pulls from the most loaded kthread, if
+ * uthreads wait here: an idle kthread parks until something wakes it, so
+ * nothing else would have it look */
+static void cfs_wake_idle_sibling(cfs_kthread_t *cfs_kthread)
+{
+	cfs_data_t *cfs_data = SCHED_DATA;
+	if (!kthread_idle_count || cfs_kthread->cfs_uthread_count < 2)
+		return;
+	int count = cfs_data->cfs_kthread_count;
+	int self = cfs_kthread - cfs_data->cfs_kthreads;
+	for (int i = 1; i < count; i++) {
+		kthread_t *k_ctx = cfs_data->cfs_kthreads[(self + i)
+		                                          % count].k_ctx;
+		if (k_ctx && k_ctx->state == KTHREAD_DONE) {
+			checkpoint("k%d: CFS: waking idle k%d",
+			           cfs_kthread->k_ctx->cpuid, k_ctx->cpuid);
+			kthread_unpark(k_ctx);
+			return;
+		}
+	}
+}
+
 uthread_t *cfs_pick_next_uthread(kthread_t *k_ctx)
 {
 	checkpoint("k%d: CFS: Picking next uthread", k_ctx->cpuid);
 
 	cfs_kthread_t *cfs_kthread = cfs_get_kthread(k_ctx);
 	assert(cfs_kthread != NULL);
+	if (gt_timeline_empty(&cfs_kthread->timeline)) {
+		cfs_pull_uthreads(cfs_kthread);
+	} else {
+		unsigned long now = cfs_now_us();
+		if (now >= cfs_kthread->next_balance) {
+			cfs_kthread->next_balance = now
+			        + CFS_BALANCE_INTERVAL_us;
+			cfs_pull_uthreads(cfs_kthread);
+		}
+		cfs_wake_idle_sibling(cfs_kthread);
+	}
 	gt_spin_lock(&cfs_kthread->lock);
-	rb_red_blk_node *min = RBDeleteMin(cfs_kthread->tree);
-	assert(min != cfs_kthread->tree->nil);
+	gt_timeline_node_t *min = gt_timeline_delete_min(&cfs_kthread->timeline);
 	if (!min) {
 		cfs_kthread->current_cfs_uthread = NULL;
 		cfs_kthread->min_vruntime = 0;
@@ -123,21 +361,39 @@ uthread_t *cfs_pick_next_uthread(kthread_t *k_ctx)
 		return NULL;
 	}
 
-	cfs_uthread_t *min_cfs_uthread = min->info;
-	checkpoint("k%d: u%d: Choosing uthread with vruntime %lu",
-	           cfs_kthread->k_ctx->cpuid, min_cfs_uthread->uthread->tid,
-	           min_cfs_uthread->key);
+	/* the group least ahead, and its uthread least ahead */
+	cfs_group_t *group = gt_timeline_entry(min, cfs_group_t, node);
+	cfs_uthread_t *min_cfs_uthread = gt_timeline_entry(
+	        gt_timeline_delete_min(&group->timeline), cfs_uthread_t, node);
+	checkpoint("k%d: u%d: Choosing uthread with vruntime %lu, group %u "
+	           "with %lu", cfs_kthread->k_ctx->cpuid,
+	           min_cfs_uthread->uthread->tid, min_cfs_uthread->vruntime,
+	           min_cfs_uthread->group_id, group->vruntime);
 	cfs_kthread->current_cfs_uthread = min_cfs_uthread;
-	cfs_kthread->min_vruntime = min_cfs_uthread->vruntime;
+	cfs_kthread->min_vruntime = group->vruntime;
+	group->min_vruntime = min_cfs_uthread->vruntime;
 	gt_spin_unlock(&cfs_kthread->lock);
 	return min_cfs_uthread->uthread;
 }
 
+/* (a * mul) >> shift without overflowing 64 bits, for shift <= 32 */
+static inline long unsigned mul_shr(long unsigned a, unsigned int mul,
+                                    unsigned int shift)
+{
+	long unsigned lo = (a & 0xffffffff) * mul;
+	long unsigned hi = (a >> 32) * mul;
+	return (lo >> shift) + (hi << (32 - shift));
+}
+
+/* charges the slice the uthread just had, in ns, scaled by
+ * CFS_NICE_0_WEIGHT / weight: slice * CFS_NICE_0_WEIGHT * wmult >> 32 */
 static void cfs_update_vruntime(cfs_uthread_t *cfs_uthread)
 {
-	struct timeval *cputime = &cfs_uthread->uthread->attr->execution_time;
-	unsigned long cputime_us = cfs_tv2us(cputime);
-	cfs_uthread->vruntime += cputime_us * cfs_uthread->priority;
+	long unsigned slice = cfs_uthread->uthread->last_slice_ns;
+	if (cfs_uthread->weight != CFS_NICE_0_WEIGHT)
+		slice = mul_shr(slice, cfs_uthread->wmult,
+		                32 - __builtin_ctz(CFS_NICE_0_WEIGHT));
+	cfs_uthread->vruntime += slice;
 }
 
 uthread_t *cfs_preemt_current_uthread(kthread_t *k_ctx)
@@ -149,111 +405,156 @@ uthread_t *cfs_preemt_current_uthread(kthread_t *k_ctx)
 
 	cfs_kthread_t *cfs_kthread = cfs_get_kthread(k_ctx);
 	cfs_uthread_t *cfs_cur_uthread = cfs_kthread->current_cfs_uthread;
+	cfs_group_t *group = cfs_get_group(cfs_kthread, cfs_cur_uthread);
+
+	/* siblings pull from our timelines and creators insert into them */
+	gt_spin_lock(&cfs_kthread->lock);
+	/* every group weighs the same */
+	group->vruntime += cur_uthread->last_slice_ns;
+	group->node.key = group->vruntime;
 
 	if (cur_uthread->state == UTHREAD_DONE) {
 		checkpoint("u%d: CFS: uthread done", cur_uthread->tid);
-		cfs_kthread->load -= cfs_cur_uthread->priority;
-		// FIXME free the node and the uthread?
-		return NULL;
+		cfs_kthread->load -= cfs_cur_uthread->weight;
+		group->load -= cfs_cur_uthread->weight;
+		if (--group->cfs_uthread_count)
+			gt_timeline_insert(&cfs_kthread->timeline,
+			                   &group->node);
+		else
+			cfs_kthread->group_count--;
+		gt_spin_unlock(&cfs_kthread->lock);
+		return NULL; /* cfs_reap_uthread() frees it */
 	}
 
 	checkpoint("u%d: CFS: uthread still runnable", cur_uthread->tid);
 	cur_uthread->state = UTHREAD_RUNNABLE;
 
 	cfs_update_vruntime(cfs_cur_uthread);
-	cfs_cur_uthread->key = cfs_cur_uthread->vruntime
-	        - cfs_kthread->min_vruntime;
-
-	checkpoint("u%d: CFS: insert into rb tree", cur_uthread->tid);
-	RBTreeInsert(cfs_kthread->tree, cfs_cur_uthread->node);
+	cfs_cur_uthread->node.key = cfs_cur_uthread->vruntime;
+	checkpoint("u%d: CFS: insert into timeline", cur_uthread->tid);
+	gt_timeline_insert(&group->timeline, &cfs_cur_uthread->node);
+	gt_timeline_insert(&cfs_kthread->timeline, &group->node);
+	gt_spin_unlock(&cfs_kthread->lock);
 
 	return cur_uthread;
 }
 
-/* finds and returns a suitable target kthread for the uthread */
+/* finds and returns a suitable target kthread for the uthread: the least
+ * loaded, then the one with fewest uthreads, counting those planned for it.
+ * Equals are taken in turn, starting after the last one chosen. Called with
+ * cfs_data->lock held */
 static cfs_kthread_t *cfs_find_kthread_target(cfs_uthread_t *cfs_uthread,
                                               cfs_data_t *cfs_data)
 {
 	checkpoint("u%d: CFS: Finding cpu target", cfs_uthread->uthread->tid);
-	cfs_kthread_t *cfs_kthread;
+	cfs_kthread_t *target = NULL;
 	unsigned int target_cpu = cfs_data->last_cpu_assiged;
-	/* round robin through the cpus */
-	do {
-		checkpoint("%s", "finding cpu...");
-		target_cpu = (target_cpu + 1) % cfs_data->cfs_kthread_count;
-		cfs_kthread = &cfs_data->cfs_kthreads[target_cpu];
-	} while (!kthread_is_schedulable(cfs_kthread->k_ctx));
-	assert(cfs_kthread->k_ctx != NULL);
+	long unsigned target_load = 0;
+	int target_count = 0;
+	for (int i = 1; i <= cfs_data->cfs_kthread_count; i++) {
+		unsigned int cpu = (cfs_data->last_cpu_assiged + i)
+		        % cfs_data->cfs_kthread_count;
+		cfs_kthread_t *cfs_kthread = &cfs_data->cfs_kthreads[cpu];
+		if (!kthread_is_schedulable(cfs_kthread->k_ctx))
+			continue;
+		long unsigned load = cfs_kthread->load
+		        + cfs_kthread->planned_load;
+		int uthread_count = cfs_kthread->cfs_uthread_count
+		        + cfs_kthread->planned_count;
+		if (!target || load < target_load
+		    || (load == target_load
+		        && uthread_count < target_count)) {
+			target = cfs_kthread;
+			target_cpu = cpu;
+			target_load = load;
+			target_count = uthread_count;
+		}
+	}
+	assert(target != NULL && target->k_ctx != NULL);
 	cfs_data->last_cpu_assiged = target_cpu;
 	checkpoint("u%d: CFS: target cpu set to %d",
 	           cfs_uthread->uthread->tid, target_cpu);
-	return cfs_kthread;
+	return target;
 }
 
-static inline long unsigned max(long unsigned a, long unsigned b)
+static cfs_uthread_t *cfs_uthread_create(uthread_t *uthread)
 {
-	return a > b ? a : b;
+	checkpoint("u%d: CFS: init uthread", uthread->tid);
+	cfs_uthread_t *cfs_uthread = kthread_slab_alloc(sizeof(*cfs_uthread));
+	cfs_uthread->uthread = uthread;
+	unsigned int priority = cfs_get_priority(uthread);
+	cfs_uthread->weight = cfs_prio_to_weight[priority];
+	cfs_uthread->wmult = cfs_prio_to_wmult[priority];
+	cfs_uthread->group_id = cfs_get_group_id(uthread);
+	return cfs_uthread;
 }
 
 static kthread_t *cfs_uthread_init(uthread_t *uthread)
 {
-	checkpoint("u%d: CFS: init uthread", uthread->tid);
-
 	cfs_data_t *cfs_data = SCHED_DATA;
-	cfs_uthread_t *cfs_uthread = emalloc(sizeof(*cfs_uthread));
-	cfs_uthread->uthread = uthread;
-	cfs_uthread->priority = CFS_DEFAULT_PRIORITY;
+	cfs_uthread_t *cfs_uthread = cfs_uthread_create(uthread);
+	/* the target's load must be up to date before the next creator
+	 * looks */
 	gt_spin_lock(&cfs_data->lock);
 	cfs_kthread_t *cfs_kthread = cfs_find_kthread_target(cfs_uthread,
 	                                                     cfs_data);
+	gt_spin_lock(&cfs_kthread->lock);
 	gt_spin_unlock(&cfs_data->lock);
 
-	/* update the kthread's load and latency, if necessary */
-	gt_spin_lock(&cfs_kthread->lock);
-	cfs_kthread->cfs_uthread_count++;
-	cfs_kthread->latency =
-	        max(CFS_DEFAULT_LATENCY_us,
-	            cfs_kthread->cfs_uthread_count * CFS_MIN_GRANULARITY_us);
-	cfs_kthread->load += cfs_uthread->priority;
-	cfs_uthread->vruntime = cfs_kthread->min_vruntime;
-	cfs_uthread->key = 0;
+	checkpoint("u%d: CFS: Insert into timeline", cfs_uthread->uthread->tid);
+	cfs_add_uthread(cfs_kthread, cfs_uthread, 0);
 	gt_spin_unlock(&cfs_kthread->lock);
 
-	checkpoint("u%d: CFS: Creating node", uthread->tid);
-	cfs_uthread->node = RBNodeCreate(&cfs_uthread->key, cfs_uthread);
-	checkpoint("u%d: CFS: Insert into rb tree", cfs_uthread->uthread->tid);
-	RBTreeInsert(cfs_kthread->tree, cfs_uthread->node);
-
 	return cfs_kthread->k_ctx;
 }
 
-/* these functions are for the rbtree. Several are no-ops. The tree is keyed
- * on vruntime, and the info pointers are to objects of type cfs_uthread_t */
-/* CompFunc takes two void pointers to keys and returns 1 if the first
- * argument is "greater than" the second.  */
-static int cfs_rb_compare_key(const void *keya, const void *keyb)
+/* places the whole batch under one acquisition of cfs_data->lock, then adds
+ * each kthread's share under one acquisition of its lock */
+static void cfs_uthread_init_many(uthread_t **uthreads, int count,
+                                  kthread_t **kthreads)
 {
-	const long unsigned *a = keya;
-	const long unsigned *b = keyb;
-	if (*a > *b)
-		return (1);
-	if (*a < *b)
-		return (-1);
-	return 0;
-}
-static void cfs_rb_print_key(const void *key)
-{
-	printf("%lu", *(long unsigned *) key);
-}
-static void cfs_rb_destroy_key(void *key)
-{
-}
-static void cfs_rb_print_info(void *info)
-{
-	printf("u%d:", ((cfs_uthread_t *) info)->uthread->tid);
+	cfs_data_t *cfs_data = SCHED_DATA;
+	cfs_uthread_t **batch = emalloc(count * sizeof(*batch));
+	gt_spin_lock(&cfs_data->lock);
+	for (int i = 0; i < count; i++) {
+		batch[i] = cfs_uthread_create(uthreads[i]);
+		cfs_kthread_t *target = cfs_find_kthread_target(batch[i],
+		                                                cfs_data);
+		target->planned_load += batch[i]->weight;
+		target->planned_count++;
+		kthreads[i] = target->k_ctx;
+	}
+	for (int cpu = 0; cpu < cfs_data->cfs_kthread_count; cpu++) {
+		cfs_kthread_t *cfs_kthread = &cfs_data->cfs_kthreads[cpu];
+		if (!cfs_kthread->planned_count)
+			continue;
+		gt_spin_lock(&cfs_kthread->lock);
+		for (int i = 0; i < count; i++)
+			if (kthreads[i] == cfs_kthread->k_ctx)
+				cfs_add_uthread(cfs_kthread, batch[i], 0);
+		gt_spin_unlock(&cfs_kthread->lock);
+		cfs_kthread->planned_load = 0;
+		cfs_kthread->planned_count = 0;
+	}
+	gt_spin_unlock(&cfs_data->lock);
+	efree(batch);
 }
-static void cfs_rb_destroy_info(void *info)
+
+/* frees the cfs_uthread of the kthread's finished uthread */
+static void cfs_reap_uthread(kthread_t *k_ctx, uthread_t *uthread)
 {
+	checkpoint("u%d: CFS: reaping", uthread->tid);
+	cfs_kthread_t *cfs_kthread = cfs_get_kthread(k_ctx);
+	cfs_uthread_t *cfs_uthread = cfs_kthread->current_cfs_uthread;
+	assert(cfs_uthread->uthread == uthread);
+
+	gt_spin_lock(&cfs_kthread->lock);
+	cfs_kthread->current_cfs_uthread = NULL;
+	cfs_kthread->cfs_uthread_count--;
+	cfs_update_latency(cfs_kthread);
+	gt_spin_unlock(&cfs_kthread->lock);
+
+	gt_slab_free(k_ctx->slab_heap, cfs_uthread);
 }
 
 /* called at every kthread_create(). Assumes cfs_init() has already been
@@ -263,17 +564,24 @@ void cfs_kthread_init(kthread_t *k_ctx)
 	checkpoint("k%d: CFS: init kthread", k_ctx->cpuid);
 	gt_spin_lock(&scheduler.lock);
 	cfs_kthread_t *cfs_kthread = cfs_get_kthread(k_ctx);
-	gt_spinlock_init(&cfs_kthread->lock);
+	gt_spinlock_init_named(&cfs_kthread->lock, "cfs_kthread");
 	cfs_kthread->k_ctx = k_ctx;
 	cfs_kthread->current_cfs_uthread = NULL;
 	cfs_kthread->cfs_uthread_count = 0;
+	cfs_kthread->planned_load = 0;
+	cfs_kthread->planned_count = 0;
+	cfs_kthread->group_count = 0;
 	cfs_kthread->latency = CFS_DEFAULT_LATENCY_us;
 	cfs_kthread->min_vruntime = 0;
-	cfs_kthread->tree = RBTreeCreate(&cfs_rb_compare_key,
-	                                 &cfs_rb_destroy_key,
-	                                 &cfs_rb_destroy_info,
-	                                 &cfs_rb_print_key,
-	                                 &cfs_rb_print_info);
+	gt_timeline_init(&cfs_kthread->timeline);
+	for (int i = 0; i < CFS_GROUP_COUNT; i++) {
+		cfs_group_t *group = &cfs_kthread->groups[i];
+		gt_timeline_init(&group->timeline);
+		group->vruntime = 0;
+		group->min_vruntime = 0;
+		group->load = 0;
+		group->cfs_uthread_count = 0;
+	}
 	cfs_data_t *cfs_data = SCHED_DATA;
 	cfs_data->cfs_kthread_count++;
 	gt_spin_unlock(&scheduler.lock);
@@ -282,7 +590,7 @@ void cfs_kthread_init(kthread_t *k_ctx)
 static void *cfs_create_sched_data(int lwp_count)
 {
 	cfs_data_t *cfs_data = ecalloc(sizeof(*cfs_data));
-	gt_spinlock_init(&cfs_data->lock);
+	gt_spinlock_init_named(&cfs_data->lock, "cfs_data");
 	cfs_data->last_cpu_assiged = 0;
 	/* array of kthread_t, index by kthread_t->cpuid */
 	cfs_kthread_t *cfs_kthreads = ecalloc(
@@ -294,9 +602,6 @@ static void *cfs_create_sched_data(int lwp_count)
 static void cfs_destroy_sched_data(void *data)
 {
 	cfs_data_t *cfs_data = data;
-	for (int i = 0; i < cfs_data->cfs_kthread_count; ++i) {
-		RBTreeDestroy(cfs_data->cfs_kthreads[i].tree);
-	}
 	free(cfs_data->cfs_kthreads);
 	free(cfs_data);
 }
@@ -306,9 +611,11 @@ void cfs_init(scheduler_t *scheduler, int lwp_count)
 	checkpoint("%s", "CFS: initialization");
 	scheduler->kthread_init = &cfs_kthread_init;
 	scheduler->uthread_init = &cfs_uthread_init;
+	scheduler->uthread_init_many = &cfs_uthread_init_many;
 	scheduler->preempt_current_uthread = &cfs_preemt_current_uthread;
 	scheduler->pick_next_uthread = &cfs_pick_next_uthread;
 	scheduler->resume_uthread = &cfs_resume_uthread;
+	scheduler->reap_uthread = &cfs_reap_uthread;
 
 	scheduler->data.buf = cfs_create_sched_data(lwp_count);
 	scheduler->data.destroy = &cfs_destroy_sched_data;
@@ -9,7 +9,7 @@
 #ifndef GT_CFS_H_
 #define GT_CFS_H_
 
-#include "rb_tree/red_black_tree.h"
+#include "gt_timeline.h"
 
 struct scheduler;
 struct kthread;
@@ -8,6 +8,7 @@
 
 #include <assert.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "gt_scheduler.h"
 #include "gt_scheduler_pcs.h"
@@ -17,20 +18,25 @@
 #include "gt_spinlock.h"
 #include "gt_pq.h"
 #include "gt_tailq.h"
-#include "gt_bitops.h"
-
-#define DEFAULT_UTHREAD_COUNT 32
-#define MAX_UTHREAD_GROUPS 32
-
-/* all threads get the same timeslice */
-#define PCS_TIMESLICE_SEC 0
-#define PCS_TIMESLICE_USEC 100000
-const struct itimerval PCS_TIMERVAL = {
-        .it_interval.tv_sec = 0,	// don't repeat
-        .it_interval.tv_usec = 0,
-        .it_value.tv_sec = PCS_TIMESLICE_SEC,
-        .it_value.tv_usec = PCS_TIMESLICE_USEC
-};
+#include "gt_tidtable.h"
+
+/* timeslices by priority: short for the highest, so that uthreads there take
+ * turns quickly, and long for the lowest, where batch work keeps its cache.
+ * Interpolated through the default priority's, in pcs_init_timeslices() */
+#define PCS_MIN_TIMESLICE_us 5000 /* 5 ms, priority 0 */
+#define PCS_DEFAULT_TIMESLICE_us 100000 /* 100 ms */
+#define PCS_MAX_TIMESLICE_us 400000 /* 400 ms, priority 63 */
+/* every group gets this long in gang mode */
+#define PCS_GANG_TIMESLICE_us 100000 /* 100 ms */
+/* low bits of pcs_data->gang_slice, holding the group */
+#define PCS_GANG_GROUP_BITS 8 /* PQ_MAX_UTHREAD_GROUP_COUNT */
+/* shortest timer set, for the end of a budget or of a gang slice */
+#define PCS_MIN_TIMER_us 1000 /* 1 ms */
+/* least a slice is charged to a budget, as though a tick had gone by */
+#define PCS_MIN_CHARGE_us 1000 /* 1 ms */
+/* how far interactivity moves a uthread from the priority it was created
+ * with, either way */
+#define PCS_MAX_BONUS 4
 
 /* global singleton scheduler */
 extern scheduler_t scheduler;
@@ -40,33 +46,59 @@ extern scheduler_t scheduler;
 
 /* global pcs data */
 typedef struct pcs_data {
-	gt_spinlock_t lock;
 	int pcs_kthread_count;
 	pcs_kthread_t *pcs_kthreads;	// array, indexed by cpuid
-	int pcs_uthread_count;
-	pcs_uthread_t **pcs_uthreads;	// array of ptrs, indexed by uthread tid
-	int pcs_uthread_array_length;	// can use to dynamically resize
-	// target cpu for last uthread from group
-	unsigned short last_ugroup_kthread[MAX_UTHREAD_GROUPS];
+	int pcs_kthreads_length;	// lwp_count, however many are up yet
+	volatile int pcs_uthread_count;
+	gt_tidtable_t pcs_uthreads;	// pcs_uthread_t *, by tid slot
+	// uthreads placed from each group, to round robin them over cpus
+	unsigned int last_ugroup_kthread[PQ_MAX_UTHREAD_GROUP_COUNT];
+
+	/* gang mode only. Time since gang_start is cut into epochs of
+	 * PCS_GANG_TIMESLICE_us, and every kthread runs the group of the
+	 * current one, so that they all switch at the same boundaries. The
+	 * first kthread to see an epoch end moves all of them on to the next
+	 * group with uthreads, under gang_lock. See pcs_gang_slice() */
+	int gang;
+	gt_spinlock_t gang_lock;
+	unsigned long gang_start; // CLOCK_MONOTONIC us
+	volatile unsigned long gang_slice; // epoch << PCS_GANG_GROUP_BITS | group
+	// live uthreads of each group
+	unsigned int gang_members[PQ_MAX_UTHREAD_GROUP_COUNT];
+
+	unsigned long timeslice_us[PQ_UTHREAD_PRIORITY_COUNT];
 } pcs_data_t;
 
+/* fills the timeslice table: linear from PCS_MIN_TIMESLICE_us up to
+ * PCS_DEFAULT_TIMESLICE_us at the default priority, and from there to
+ * PCS_MAX_TIMESLICE_us */
+static void pcs_init_timeslices(pcs_data_t *pcs_data)
+{
+	const int def = PQ_DEFAULT_UTHREAD_PRIORITY;
+	const int max = PQ_MAX_UTHREAD_PRIORITY;
+	for (int p = 0; p <= max; p++)
+		pcs_data->timeslice_us[p] = p <= def
+		        ? PCS_MIN_TIMESLICE_us + (PCS_DEFAULT_TIMESLICE_us
+		                - PCS_MIN_TIMESLICE_us) * p / def
+		        : PCS_DEFAULT_TIMESLICE_us + (PCS_MAX_TIMESLICE_us
+		                - PCS_DEFAULT_TIMESLICE_us) * (p - def) / (max - def);
+}
+
 /* creates and inits the sched data */
 void *pcs_create_sched_data(int lwp_count)
 {
 	pcs_data_t *pcs_data = ecalloc(sizeof(*pcs_data));
-	gt_spinlock_init(&pcs_data->lock);
 
 	/* array of kthread_t, index by kthread_t->cpuid */
 	pcs_kthread_t *pcs_kthreads = ecalloc(lwp_count * sizeof(*pcs_kthreads));
 	pcs_data->pcs_kthreads = pcs_kthreads;
+	pcs_data->pcs_kthreads_length = lwp_count;
 
-	/* array of uthread_t, index by uthread_t->tid */
-	pcs_data->pcs_uthread_array_length = DEFAULT_UTHREAD_COUNT;
-	pcs_uthread_t **pcs_uthreads = ecalloc(
-	        pcs_data->pcs_uthread_array_length * sizeof(*pcs_uthreads));
-	pcs_data->pcs_uthreads = pcs_uthreads;
+	gt_tidtable_init(&pcs_data->pcs_uthreads);
 	pcs_data->pcs_uthread_count = 0;
 	pcs_data->pcs_kthread_count = 0;
+	gt_spinlock_init_named(&pcs_data->gang_lock, "pcs_gang");
+	pcs_init_timeslices(pcs_data);
 
 	return pcs_data;
 }
@@ -78,11 +110,20 @@ static inline pcs_kthread_t *pcs_get_kthread(kthread_t *k_ctx)
 	return &pcs_data->pcs_kthreads[k_ctx->cpuid];
 }
 
+/* CLOCK_MONOTONIC in microseconds */
+static inline unsigned long pcs_now_us(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
 /* returns the corresponding pcs_uthread_t for the given uthread_t */
 static inline pcs_uthread_t *pcs_get_uthread(uthread_t *uthread)
 {
 	pcs_data_t *pcs_data = SCHED_DATA;
-	return pcs_data->pcs_uthreads[uthread->tid];
+	return gt_tidtable_get(&pcs_data->pcs_uthreads,
+	                       uthread_tid_index(uthread->tid));
 }
 
 /* called at every kthread_create(). Assumes pcs_init() has already been
@@ -92,7 +133,7 @@ void pcs_kthread_init(kthread_t *k_ctx)
 	gt_spin_lock(&scheduler.lock);
 	pcs_kthread_t *pcs_kthread = pcs_get_kthread(k_ctx);
 	pcs_kthread->k_ctx = k_ctx;
-	kthread_init_runqueue(&pcs_kthread->k_runqueue);
+	kthread_init_runqueue(&pcs_kthread->k_runqueue, k_ctx->slab_heap);
 	pcs_data_t *pcs_data = SCHED_DATA;
 	pcs_data->pcs_kthread_count++;
 	gt_spin_unlock(&scheduler.lock);
@@ -106,85 +147,186 @@ static pcs_kthread_t *pcs_find_kthread_target(pcs_uthread_t *pcs_uthread,
 	uthread_gid gid = pcs_uthread->group_id;
 	checkpoint("u%d: PCS: Finding cpu target, group (%d)",
 	           pcs_uthread->uthread->tid, gid);
-	unsigned int target_cpu = pcs_data->last_ugroup_kthread[gid];
+	unsigned int target_cpu;
 	/* we want to avoid putting uthreads of the same group on a cpu: round
-	 * robin through the cpus */
+	 * robin through the cpus. Creators on other kthreads just take the
+	 * next turn */
 	do {
-		target_cpu = (target_cpu + 1) % pcs_data->pcs_kthread_count;
+		target_cpu = __sync_add_and_fetch(
+		        &pcs_data->last_ugroup_kthread[gid], 1)
+		        % pcs_data->pcs_kthread_count;
 		pcs_kthread = &pcs_data->pcs_kthreads[target_cpu];
 	} while (!kthread_is_schedulable(pcs_kthread->k_ctx));
 	assert(pcs_kthread->k_ctx != NULL);
-	pcs_data->last_ugroup_kthread[gid] = target_cpu;
 	checkpoint("u%d: PCS: target cpu set to %d",
 	           pcs_uthread->uthread->tid, target_cpu);
 	return &pcs_data->pcs_kthreads[target_cpu];
 }
 
-/* makes more room for uthreads and returns the new array. `arr_length` is
- * updated new length */
-static void *pcs_double_array_length(pcs_uthread_t **arr, int *arr_length)
+/* allocates a new pcs_uthread, files it under the uthread's tid and returns
+ * it. Other kthreads may be looking up other tids meanwhile */
+static pcs_uthread_t *pcs_pcs_uthread_create(uthread_t *uthread)
 {
-	*arr_length *= 2;
-	size_t blocksize = *arr_length * sizeof(arr[0]);
-	void *p = realloc(arr, blocksize);
-	if (!p)
-		fail("realloc");
-	return p;
+	pcs_data_t *pcs_data = SCHED_DATA;
+	pcs_uthread_t *pcs_uthread = kthread_slab_alloc(sizeof(*pcs_uthread));
+	gt_tidtable_set(&pcs_data->pcs_uthreads, uthread_tid_index(uthread->tid),
+	                pcs_uthread);
+	__sync_add_and_fetch(&pcs_data->pcs_uthread_count, 1);
+	return pcs_uthread;
 }
 
-/* allocates space for new pcs_uthread and returns it. Increases the size of the
- * array pcs_data->pcs_uthreads if necessary */
-static pcs_uthread_t *pcs_pcs_uthread_create(uthread_t *uthread)
+/* pushes the chain from `newest` through inbox_next to `oldest` on the inbox
+ * of `pcs_kthread`, from any kthread, with a single CAS */
+static void pcs_inbox_post_chain(pcs_kthread_t *pcs_kthread,
+                                 pcs_uthread_t *newest, pcs_uthread_t *oldest)
 {
-	pcs_data_t *pcs_data = SCHED_DATA;
-	while (uthread->tid >= pcs_data->pcs_uthread_array_length) {
-		checkpoint("u%d: PCS: we need more space for uthreads",
-		           uthread->tid);
-		pcs_data->pcs_uthreads = pcs_double_array_length(
-		        pcs_data->pcs_uthreads,
-		        &pcs_data->pcs_uthread_array_length);
+	pcs_uthread_t *head;
+	do {
+		head = pcs_kthread->inbox;
+		oldest->inbox_next = head;
+	} while (!__sync_bool_compare_and_swap(&pcs_kthread->inbox, head,
+	                                       newest));
+}
+
+static inline void pcs_inbox_post(pcs_kthread_t *pcs_kthread,
+                                  pcs_uthread_t *pcs_uthread)
+{
+	pcs_inbox_post_chain(pcs_kthread, pcs_uthread, pcs_uthread);
+}
+
+/* moves everything posted to our inbox onto the active runq, in the order it
+ * was posted */
+static void pcs_inbox_drain(pcs_kthread_t *pcs_kthread)
+{
+	if (!pcs_kthread->inbox)
+		return;
+	pcs_uthread_t *posted = __sync_lock_test_and_set(&pcs_kthread->inbox,
+	                                                 NULL);
+	pcs_uthread_t *fifo = NULL, *next;
+	for (; posted; posted = next) {
+		next = posted->inbox_next;
+		posted->inbox_next = fifo;
+		fifo = posted;
 	}
-	pcs_uthread_t *pcs_uthread = emalloc(sizeof(*pcs_uthread));
-	pcs_data->pcs_uthreads[uthread->tid] = pcs_uthread;
-	pcs_data->pcs_uthread_count++;
-	return pcs_uthread;
+	kthread_runqueue_t *kthread_runq = &pcs_kthread->k_runqueue;
+	for (; fifo; fifo = fifo->inbox_next)
+		add_to_runqueue(kthread_runq->active_runq, NULL, fifo);
 }
 
 /* Called on uthread_create(). Must assign the new uthread to a kthread;
  * anything else is left up to the implementation. Can't assume the uthread
  * itself has been initialized in any way---it just has a tid
  */
-kthread_t *pcs_uthread_init(uthread_t *uthread)
+/* sets up the pcs_uthread of a new uthread and returns the kthread to post
+ * it to */
+static pcs_kthread_t *pcs_uthread_setup(uthread_t *uthread,
+                                        pcs_uthread_t **pcs_uthread_out)
 {
 	checkpoint("u%d: PCS: init uthread", uthread->tid);
 
 	pcs_data_t *pcs_data = SCHED_DATA;
-	gt_spin_lock(&pcs_data->lock);
-
 	pcs_uthread_t *pcs_uthread = pcs_pcs_uthread_create(uthread);
 	pcs_uthread->uthread = uthread;
-	pcs_uthread->priority = pq_get_priority(uthread);
+	pcs_uthread->base_priority = pq_get_priority(uthread);
+	pcs_uthread->priority = pcs_uthread->base_priority;
+	pcs_uthread->bonus = 0;
+	pcs_uthread->slice_left_us = pcs_data->timeslice_us[pcs_uthread->priority];
 	pcs_uthread->group_id = pq_get_group_id(uthread);
+	if (pcs_data->gang)
+		__sync_add_and_fetch(
+		        &pcs_data->gang_members[pcs_uthread->group_id], 1);
 
-	pcs_kthread_t *pcs_kthread = pcs_find_kthread_target(pcs_uthread,
-	                                                     pcs_data);
-	add_to_runqueue(pcs_kthread->k_runqueue.active_runq,
-	                &pcs_kthread->k_runqueue.kthread_runqlock,
-	                pcs_uthread);
-	gt_spin_unlock(&pcs_data->lock);
+	*pcs_uthread_out = pcs_uthread;
+	return pcs_find_kthread_target(pcs_uthread, pcs_data);
+}
+
+kthread_t *pcs_uthread_init(uthread_t *uthread)
+{
+	pcs_uthread_t *pcs_uthread;
+	pcs_kthread_t *pcs_kthread = pcs_uthread_setup(uthread, &pcs_uthread);
+	pcs_inbox_post(pcs_kthread, pcs_uthread);
 	assert(pcs_kthread != NULL);
 	assert(pcs_kthread->k_ctx != NULL);
 	return pcs_kthread->k_ctx;
 }
 
-static void pcs_insert_zombie(pcs_uthread_t *pcs_uthread,
-                              kthread_runqueue_t *k_runq)
+/* chains the batch up by kthread, then posts each chain with one CAS */
+void pcs_uthread_init_many(uthread_t **uthreads, int count,
+                           kthread_t **kthreads)
+{
+	pcs_data_t *pcs_data = SCHED_DATA;
+	int kthread_count = pcs_data->pcs_kthreads_length;
+	pcs_uthread_t **newest = ecalloc(2 * kthread_count * sizeof(*newest));
+	pcs_uthread_t **oldest = newest + kthread_count;
+	for (int i = 0; i < count; i++) {
+		pcs_uthread_t *pcs_uthread;
+		pcs_kthread_t *pcs_kthread = pcs_uthread_setup(uthreads[i],
+		                                               &pcs_uthread);
+		int cpu = pcs_kthread - pcs_data->pcs_kthreads;
+		pcs_uthread->inbox_next = newest[cpu];
+		newest[cpu] = pcs_uthread;
+		if (!oldest[cpu])
+			oldest[cpu] = pcs_uthread;
+		kthreads[i] = pcs_kthread->k_ctx;
+	}
+	for (int cpu = 0; cpu < kthread_count; cpu++)
+		if (newest[cpu])
+			pcs_inbox_post_chain(&pcs_data->pcs_kthreads[cpu],
+			                     newest[cpu], oldest[cpu]);
+	efree(newest);
+}
+
+/* moves the uthread's priority by `step` levels of bonus, up for a positive
+ * one, keeping within PCS_MAX_BONUS of its base priority. Only while it is off
+ * the runqueues, since they file it by priority */
+static void pcs_adjust_bonus(pcs_uthread_t *pcs_uthread, int step)
 {
-	uthread_head_t *kthread_zhead = &(k_runq->zombie_uthreads);
-	gt_spin_lock(&(k_runq->kthread_runqlock));
-	k_runq->kthread_runqlock.holder = 0x01;
-	TAILQ_INSERT_TAIL(kthread_zhead, pcs_uthread, uthread_runq);
-	gt_spin_unlock(&(k_runq->kthread_runqlock));
+	int bonus = pcs_uthread->bonus + step;
+	if (bonus > PCS_MAX_BONUS)
+		bonus = PCS_MAX_BONUS;
+	else if (bonus < -PCS_MAX_BONUS)
+		bonus = -PCS_MAX_BONUS;
+	pcs_uthread->bonus = bonus;
+
+	int priority = pcs_uthread->base_priority - bonus;
+	if (priority < PQ_MIN_UTHREAD_PRIORITY)
+		priority = PQ_MIN_UTHREAD_PRIORITY;
+	else if (priority > PQ_MAX_UTHREAD_PRIORITY)
+		priority = PQ_MAX_UTHREAD_PRIORITY;
+	pcs_uthread->priority = priority;
+}
+
+/* charges the slice just run to the uthread's budget for this epoch. One with
+ * budget left returns 1: it goes back on the active runq, to get the cpu
+ * again soon, and gains a bonus if it yielded rather than being preempted.
+ * One that used it all up loses a bonus and gets a new budget at its new
+ * priority, for the next epoch.
+ * Every slice costs at least PCS_MIN_CHARGE_us, so that a uthread yielding in
+ * a loop can't keep the cpu from those below it for long */
+static int pcs_charge_slice(pcs_uthread_t *pcs_uthread)
+{
+	pcs_data_t *pcs_data = SCHED_DATA;
+	unsigned long used_us = pcs_uthread->uthread->last_slice_ns / 1000;
+	if (used_us < PCS_MIN_CHARGE_us)
+		used_us = PCS_MIN_CHARGE_us;
+	if (used_us + PCS_MIN_TIMER_us <= pcs_uthread->slice_left_us) {
+		pcs_uthread->slice_left_us -= used_us;
+		if (pcs_uthread->uthread->yielded)
+			pcs_adjust_bonus(pcs_uthread, 1);
+		return 1;
+	}
+	pcs_adjust_bonus(pcs_uthread, -1);
+	pcs_uthread->slice_left_us = pcs_data->timeslice_us[pcs_uthread->priority];
+	return 0;
+}
+
+/* the lock the owner takes to work on its own runqueues: kthread_runqlock in
+ * gang mode, where siblings take uthreads off them, else NULL. Nothing else
+ * touches them outside gang mode; uthreads come in through the inbox */
+static inline gt_spinlock_t *pcs_owner_runqlock(kthread_runqueue_t *k_runq)
+{
+	pcs_data_t *pcs_data = SCHED_DATA;
+	return pcs_data->gang ? &k_runq->kthread_runqlock : NULL;
 }
 
 uthread_t *pcs_preemt_current_uthread(kthread_t *k_ctx)
@@ -199,31 +341,207 @@ uthread_t *pcs_preemt_current_uthread(kthread_t *k_ctx)
 	kthread_runqueue_t *k_runq = &pcs_kthread->k_runqueue;
 	if (cur_uthread->state == UTHREAD_DONE) {
 		checkpoint("u%d: PCS: uthread done", cur_uthread->tid);
-		pcs_insert_zombie(pcs_cur_uthread, k_runq);
-		return NULL;
+		return NULL; /* pcs_reap_uthread() cleans up */
 	}
 
 	checkpoint("u%d: PCS: uthread still runnable", cur_uthread->tid);
 	cur_uthread->state = UTHREAD_RUNNABLE;
-	add_to_runqueue(k_runq->expires_runq, &k_runq->kthread_runqlock,
-	                pcs_cur_uthread);
+	runqueue_t *runq = pcs_charge_slice(pcs_cur_uthread)
+	        ? k_runq->active_runq : k_runq->expires_runq;
+	add_to_runqueue(runq, pcs_owner_runqlock(k_runq), pcs_cur_uthread);
 	return cur_uthread;
 }
 
-/* [1] Tries to find the highest priority RUNNABLE uthread in active-runq.
+/* Hands half of what we have queued to an idle sibling, through its inbox,
+ * and unparks it: an idle kthread doesn't look for work itself, so a busy one
+ * passes some on when it next picks. Our active runq goes first, since those
+ * have not run this epoch, and our expires runq after that: we have run them
+ * least recently, so they are the coldest in our cache. We keep at least one.
+ * A sibling with something in its inbox already is on its way */
+static void pcs_share_load(pcs_kthread_t *pcs_kthread)
+{
+	pcs_data_t *pcs_data = SCHED_DATA;
+	kthread_runqueue_t *k_runq = &pcs_kthread->k_runqueue;
+	unsigned int queued = k_runq->runqueues[0].uthread_tot
+	        + k_runq->runqueues[1].uthread_tot;
+	if (!kthread_idle_count || queued < 2)
+		return;
+
+	pcs_kthread_t *idle = NULL;
+	int count = pcs_data->pcs_kthread_count;
+	int self = pcs_kthread - pcs_data->pcs_kthreads;
+	for (int i = 1; i < count && !idle; i++) {
+		pcs_kthread_t *sibling = &pcs_data->pcs_kthreads[(self + i)
+		                                                 % count];
+		if (sibling->k_ctx && sibling->k_ctx->state == KTHREAD_DONE
+		    && !sibling->inbox)
+			idle = sibling;
+	}
+	if (!idle)
+		return;
+
+	pcs_uthread_t *newest = NULL, *oldest = NULL;
+	for (unsigned int n = queued / 2; n; n--) {
+		runqueue_t *runq = k_runq->active_runq;
+		if (!runq->uthread_mask)
+			runq = k_runq->expires_runq;
+		pcs_uthread_t *given = peek_runqueue(runq);
+		rem_from_runqueue(runq, NULL, given);
+		given->inbox_next = newest;
+		newest = given;
+		if (!oldest)
+			oldest = given;
+	}
+	checkpoint("k%d: PCS: handing %u uthreads to k%d",
+	           pcs_kthread->k_ctx->cpuid, queued / 2,
+	           idle->k_ctx->cpuid);
+	pcs_inbox_post_chain(idle, newest, oldest);
+	kthread_kick(idle->k_ctx);
+}
+
+/* takes the uthread of `group` to run next off `kthread_runq`, active runq
+ * first; NULL if it has none. Called with its kthread_runqlock held */
+static pcs_uthread_t *pcs_take_group_uthread(kthread_runqueue_t *kthread_runq,
+                                             int group)
+{
+	runqueue_t *runq = kthread_runq->active_runq;
+	pcs_uthread_t *member = peek_runqueue_group(runq, group);
+	if (!member) {
+		runq = kthread_runq->expires_runq;
+		member = peek_runqueue_group(runq, group);
+	}
+	if (member)
+		rem_from_runqueue(runq, NULL, member);
+	return member;
+}
+
+/* gang_slice packs the epoch with its group, so that one load reads both */
+static inline unsigned long pcs_gang_epoch(unsigned long gang_slice)
+{
+	return gang_slice >> PCS_GANG_GROUP_BITS;
+}
+
+static inline int pcs_gang_group(unsigned long gang_slice)
+{
+	return gang_slice & ((1UL << PCS_GANG_GROUP_BITS) - 1);
+}
+
+/* when `epoch` ends, the same for every kthread */
+static inline unsigned long pcs_gang_epoch_end_us(pcs_data_t *pcs_data,
+                                                  unsigned long epoch)
+{
+	return pcs_data->gang_start + (epoch + 1) * PCS_GANG_TIMESLICE_us;
+}
+
+/* moves the gang on to the next group with live uthreads once the epoch is
+ * up, and has every other kthread pick again so that they all switch
+ * together. The first kthread to see the epoch end does it. Epochs that went
+ * by unseen are skipped, so boundaries stay where every kthread expects
+ * them */
+static void pcs_gang_advance(pcs_kthread_t *pcs_kthread)
+{
+	pcs_data_t *pcs_data = SCHED_DATA;
+	gt_spin_lock(&pcs_data->gang_lock);
+	unsigned long now = pcs_now_us();
+	unsigned long slice = pcs_data->gang_slice;
+	if (now < pcs_gang_epoch_end_us(pcs_data, pcs_gang_epoch(slice))) {
+		gt_spin_unlock(&pcs_data->gang_lock);
+		return;
+	}
+	int group = pcs_gang_group(slice), next = group;
+	for (int i = 1; i <= PQ_MAX_UTHREAD_GROUP_COUNT; i++) {
+		int g = (group + i) % PQ_MAX_UTHREAD_GROUP_COUNT;
+		if (pcs_data->gang_members[g]) {
+			next = g;
+			break;
+		}
+	}
+	unsigned long epoch = (now - pcs_data->gang_start)
+	        / PCS_GANG_TIMESLICE_us;
+	pcs_data->gang_slice = epoch << PCS_GANG_GROUP_BITS | next;
+	gt_spin_unlock(&pcs_data->gang_lock);
+	if (next == group)
+		return;
+
+	checkpoint("k%d: PCS: gang epoch %lu runs group %d",
+	           pcs_kthread->k_ctx->cpuid, epoch, next);
+	for (int i = 0; i < pcs_data->pcs_kthread_count; i++) {
+		pcs_kthread_t *sibling = &pcs_data->pcs_kthreads[i];
+		if (sibling != pcs_kthread && sibling->k_ctx)
+			kthread_resched(sibling->k_ctx);
+	}
+}
+
+/* gang mode: a uthread of the gang's group, our own or else one queued on a
+ * sibling, since the sibling can run only one of them at a time. NULL if
+ * there is none; the caller then runs something else meanwhile */
+static pcs_uthread_t *pcs_gang_pick(pcs_kthread_t *pcs_kthread)
+{
+	pcs_data_t *pcs_data = SCHED_DATA;
+	unsigned long slice = pcs_data->gang_slice;
+	if (pcs_now_us() >= pcs_gang_epoch_end_us(pcs_data,
+	                                          pcs_gang_epoch(slice))) {
+		pcs_gang_advance(pcs_kthread);
+		slice = pcs_data->gang_slice;
+	}
+	/* lines up our timer with the others': see pcs_gang_resume_uthread() */
+	pcs_kthread->gang_epoch = pcs_gang_epoch(slice);
+	int group = pcs_gang_group(slice);
+
+	kthread_runqueue_t *kthread_runq = &pcs_kthread->k_runqueue;
+	gt_spin_lock(&kthread_runq->kthread_runqlock);
+	pcs_inbox_drain(pcs_kthread);
+	pcs_share_load(pcs_kthread);
+	pcs_uthread_t *member = pcs_take_group_uthread(kthread_runq, group);
+	gt_spin_unlock(&kthread_runq->kthread_runqlock);
+	if (member)
+		return member;
+
+	for (int i = 0; i < pcs_data->pcs_kthread_count && !member; i++) {
+		pcs_kthread_t *sibling = &pcs_data->pcs_kthreads[i];
+		kthread_runqueue_t *k_runq = &sibling->k_runqueue;
+		/* unlocked hints are good enough to choose by */
+		if (sibling == pcs_kthread
+		    || (!peek_runqueue_group(&k_runq->runqueues[0], group)
+		        && !peek_runqueue_group(&k_runq->runqueues[1], group)))
+			continue;
+		gt_spin_lock(&k_runq->kthread_runqlock);
+		member = pcs_take_group_uthread(k_runq, group);
+		gt_spin_unlock(&k_runq->kthread_runqlock);
+		if (member)
+			checkpoint("k%d: PCS: gang took u%d from k%d",
+			           pcs_kthread->k_ctx->cpuid,
+			           member->uthread->tid, sibling->k_ctx->cpuid);
+	}
+	return member;
+}
+
+/* [0] Takes in the uthreads posted to us
+ * [1] Tries to find the highest priority RUNNABLE uthread in active-runq.
  * [2] Found - Jump to [FOUND]
  * [3] Switches runqueues (active/expires)
  * [4] Repeat [1] through [2]
- * [NOT FOUND] Return NULL(no more jobs)
- * [FOUND] Remove uthread from pq and return it. */
+ * [NOT FOUND] Return NULL; a busy sibling hands us some (pcs_share_load())
+ * [FOUND] Remove uthread from pq and return it.
+ * In gang mode a uthread of the gang's group comes before all of these */
 uthread_t *pcs_pick_next_uthread(kthread_t *k_ctx)
 {
 	checkpoint("k%d: PCS: Picking next uthread", k_ctx->cpuid);
 	pcs_kthread_t *pcs_kthread = pcs_get_kthread(k_ctx);
 	kthread_runqueue_t *kthread_runq = &pcs_kthread->k_runqueue;
 
-	gt_spin_lock(&(kthread_runq->kthread_runqlock));
-	kthread_runq->kthread_runqlock.holder = 0x04;
+	pcs_data_t *pcs_data = SCHED_DATA;
+	if (pcs_data->gang) {
+		pcs_uthread_t *member = pcs_gang_pick(pcs_kthread);
+		if (member)
+			return member->uthread;
+	}
+
+	gt_spinlock_t *runqlock = pcs_owner_runqlock(kthread_runq);
+	if (runqlock)
+		gt_spin_lock(runqlock);
+	pcs_inbox_drain(pcs_kthread);
+	pcs_share_load(pcs_kthread);
 
 	runqueue_t *runq = kthread_runq->active_runq;
 	if (!(runq->uthread_mask)) { /* No jobs in active. switch runqueue */
@@ -235,45 +553,95 @@ uthread_t *pcs_pick_next_uthread(kthread_t *k_ctx)
 		runq = kthread_runq->active_runq;
 		if (!runq->uthread_mask) {
 			assert(!runq->uthread_tot);
-			gt_spin_unlock(&(kthread_runq->kthread_runqlock));
+			if (runqlock)
+				gt_spin_unlock(runqlock);
 			return NULL;
 		}
 	}
 
-	/* Find the highest priority bucket */
-	unsigned int uprio, ugroup;
-	uprio = LOWEST_BIT_SET(runq->uthread_mask);
-	prio_struct_t *prioq = &(runq->prio_array[uprio]);
-
-	assert(prioq->group_mask);
-	ugroup = LOWEST_BIT_SET(prioq->group_mask);
-
-	uthread_head_t *u_head = &(prioq->group[ugroup]);
-	pcs_uthread_t *next_uthread = TAILQ_FIRST(u_head);
+	pcs_uthread_t *next_uthread = peek_runqueue(runq);
 	rem_from_runqueue(runq, NULL, next_uthread);
-
-	gt_spin_unlock(&(kthread_runq->kthread_runqlock));
+	if (runqlock)
+		gt_spin_unlock(runqlock);
 	return next_uthread->uthread;
 }
 
 /* called right before current uthread resumes execution. should set a timer to ensure
- * that we get back to scheduling again.
+ * that we get back to scheduling again, when the uthread's budget runs out.
+ * With nothing else to run, the timer is stopped instead.
  */
 void pcs_resume_uthread(kthread_t *k_ctx)
 {
 	checkpoint("k%d: u%d: PCS: Setting timer",
 	           k_ctx->cpuid, k_ctx->current_uthread->tid);
 	k_ctx->current_uthread->state = UTHREAD_RUNNING;
-	if (setitimer(ITIMER_VIRTUAL, &PCS_TIMERVAL, NULL)) // ignore old timer
-		fail_perror("setitimer");
+
+	pcs_kthread_t *pcs_kthread = pcs_get_kthread(k_ctx);
+	kthread_runqueue_t *kthread_runq = &pcs_kthread->k_runqueue;
+	kthread_tickless_prepare(k_ctx);
+	if (kthread_runq->active_runq->uthread_tot
+	    || kthread_runq->expires_runq->uthread_tot || pcs_kthread->inbox)
+		kthread_set_timeslice(k_ctx, pcs_get_uthread(
+		        k_ctx->current_uthread)->slice_left_us);
+	else
+		kthread_set_timeslice(k_ctx, 0);
 	return;
 }
 
+/* gang mode: like pcs_resume_uthread(), but never runs past the end of the
+ * epoch we last picked in, so that this kthread is on time to move on with
+ * the others */
+void pcs_gang_resume_uthread(kthread_t *k_ctx)
+{
+	checkpoint("k%d: u%d: PCS: Setting gang timer",
+	           k_ctx->cpuid, k_ctx->current_uthread->tid);
+	k_ctx->current_uthread->state = UTHREAD_RUNNING;
+
+	pcs_kthread_t *pcs_kthread = pcs_get_kthread(k_ctx);
+	kthread_runqueue_t *kthread_runq = &pcs_kthread->k_runqueue;
+	pcs_data_t *pcs_data = SCHED_DATA;
+	kthread_tickless_prepare(k_ctx);
+	if (kthread_runq->active_runq->uthread_tot
+	    || kthread_runq->expires_runq->uthread_tot || pcs_kthread->inbox) {
+		unsigned long now = pcs_now_us();
+		unsigned long deadline = pcs_gang_epoch_end_us(pcs_data,
+		                                               pcs_kthread->gang_epoch);
+		unsigned long left = deadline > now ? deadline - now : 0;
+		unsigned long budget = pcs_get_uthread(
+		        k_ctx->current_uthread)->slice_left_us;
+		if (left > budget)
+			left = budget;
+		kthread_set_timeslice(k_ctx, left > PCS_MIN_TIMER_us
+		                             ? left : PCS_MIN_TIMER_us);
+	} else {
+		kthread_set_timeslice(k_ctx, 0);
+	}
+	return;
+}
+
+/* frees the pcs_uthread of a finished uthread and its slot in pcs_uthreads */
+void pcs_reap_uthread(kthread_t *k_ctx, uthread_t *uthread)
+{
+	checkpoint("u%d: PCS: reaping", uthread->tid);
+	pcs_data_t *pcs_data = SCHED_DATA;
+	unsigned index = uthread_tid_index(uthread->tid);
+	pcs_uthread_t *pcs_uthread = gt_tidtable_get(&pcs_data->pcs_uthreads,
+	                                             index);
+	gt_tidtable_set(&pcs_data->pcs_uthreads, index, NULL);
+	__sync_sub_and_fetch(&pcs_data->pcs_uthread_count, 1);
+	if (pcs_data->gang)
+		__sync_sub_and_fetch(
+		        &pcs_data->gang_members[pcs_uthread->group_id], 1);
+	gt_slab_free(k_ctx->slab_heap, pcs_uthread);
+}
+
 void pcs_destroy_sched_data(void *data)
 {
 	pcs_data_t *pcs_data = data;
+	for (int i = 0; i < pcs_data->pcs_kthread_count; i++)
+		kthread_destroy_runqueue(&pcs_data->pcs_kthreads[i].k_runqueue);
 	free(pcs_data->pcs_kthreads);
-	free(pcs_data->pcs_uthreads);
+	gt_tidtable_destroy(&pcs_data->pcs_uthreads);
 	free(pcs_data);
 }
 
@@ -282,10 +650,22 @@ void pcs_init(scheduler_t *scheduler, int lwp_count)
 	checkpoint("%s", "PCS: initialization");
 	scheduler->kthread_init = &pcs_kthread_init;
 	scheduler->uthread_init = &pcs_uthread_init;
+	scheduler->uthread_init_many = &pcs_uthread_init_many;
 	scheduler->preempt_current_uthread = &pcs_preemt_current_uthread;
 	scheduler->pick_next_uthread = &pcs_pick_next_uthread;
 	scheduler->resume_uthread = &pcs_resume_uthread;
+	scheduler->reap_uthread = &pcs_reap_uthread;
 
 	scheduler->data.buf = pcs_create_sched_data(lwp_count);
 	scheduler->data.destroy = &pcs_destroy_sched_data;
 }
+
+void pcs_gang_init(scheduler_t *scheduler, int lwp_count)
+{
+	pcs_init(scheduler, lwp_count);
+	checkpoint("%s", "PCS: gang mode");
+	scheduler->resume_uthread = &pcs_gang_resume_uthread;
+	pcs_data_t *pcs_data = scheduler->data.buf;
+	pcs_data->gang = 1;
+	pcs_data->gang_start = pcs_now_us();
+}
@@ -19,16 +19,29 @@ struct uthread;
 typedef struct pcs_kthread {
 	struct kthread *k_ctx;
 	kthread_runqueue_t k_runqueue;
+	/* uthreads posted to us, newest first. Anyone pushes with a CAS; only
+	 * we take them off, all at once, into k_runqueue */
+	struct pcs_uthread *volatile inbox;
+	unsigned long gang_epoch; /* gang mode: the epoch we last picked in */
 } pcs_kthread_t;
 
 /* data maintained internally for each uthread */
 typedef struct pcs_uthread {
 	struct uthread *uthread;
-	int priority;
+	int base_priority;	// as created
+	int priority;		// what the runqueues file it by: base less bonus
+	int bonus;		// -PCS_MAX_BONUS..PCS_MAX_BONUS, up for yielding early
+	unsigned long slice_left_us;	// budget left this epoch
 	int group_id;
 	TAILQ_ENTRY(pcs_uthread) uthread_runq;
+	struct pcs_uthread *inbox_next;
 } pcs_uthread_t;
 
 void pcs_init(struct scheduler *scheduler, int lwp_count);
+/* PCS in gang mode: time is cut into slices shared by every kthread, and in
+ * each one all kthreads run uthreads of the same group, one group after the
+ * other. A kthread with none of that group's uthreads takes one from a
+ * sibling, then falls back to its own uthreads of other groups */
+void pcs_gang_init(struct scheduler *scheduler, int lwp_count);
 
 #endif /* GT_PCS_H_ */
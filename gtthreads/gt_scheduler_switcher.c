@@ -25,5 +25,8 @@ void scheduler_switch(scheduler_t *scheduler, scheduler_type_t sched_type,
 	case SCHEDULER_CFS:
 		cfs_init(scheduler, lwp_count);
 		break;
+	case SCHEDULER_GANG:
+		pcs_gang_init(scheduler, lwp_count);
+		break;
 	}
 }
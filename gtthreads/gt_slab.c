@@ -0,0 +1,134 @@
+/*
+ * gt_slab.c
+ *
+ * Per-kthread slab caches. See gt_slab.h
+ */
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "gt_slab.h"
+#include "gt_common.h"
+#include "gt_spinlock.h"
+
+/* free objects are linked through their own memory */
+struct gt_slab_obj {
+	struct gt_slab_obj *next;
+};
+
+/* sits at the start of every slab */
+typedef struct gt_slab {
+	gt_slab_heap_t *heap;
+	unsigned class;
+} gt_slab_t;
+
+/* objects start a cache line in, after the header */
+#define GT_SLAB_HDR_SIZE 64
+
+/* heaps of exited kthreads, waiting to be taken over */
+static gt_slab_heap_t *gt_slab_orphans = NULL;
+static gt_spinlock_t gt_slab_orphans_lock =
+	GT_SPINLOCK_NAMED_INITIALIZER("slab_orphans");
+
+static inline gt_slab_t *gt_slab_of(void *obj)
+{
+	return (gt_slab_t *) ((uintptr_t) obj & ~(GT_SLAB_SIZE - 1));
+}
+
+/* returns the size class for `size`, or -1 if it is too big for a slab */
+static int gt_slab_class(size_t size)
+{
+	int class = 0;
+	while (((size_t) 1 << (GT_SLAB_MIN_SHIFT + class)) < size)
+		if (++class == GT_SLAB_CLASSES)
+			return -1;
+	return class;
+}
+
+/* maps a GT_SLAB_SIZE-aligned slab by over-mapping and trimming */
+static gt_slab_t *gt_slab_map(void)
+{
+	char *p = mmap(NULL, 2 * GT_SLAB_SIZE, PROT_READ | PROT_WRITE,
+	               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		fail_perror("mmap");
+	char *slab = (char *) (((uintptr_t) p + GT_SLAB_SIZE - 1)
+	                       & ~(GT_SLAB_SIZE - 1));
+	if (slab > p)
+		munmap(p, slab - p);
+	if (slab < p + GT_SLAB_SIZE)
+		munmap(slab + GT_SLAB_SIZE, p + GT_SLAB_SIZE - slab);
+	return (gt_slab_t *) slab;
+}
+
+gt_slab_heap_t *gt_slab_heap_get(void)
+{
+	gt_spin_lock(&gt_slab_orphans_lock);
+	gt_slab_heap_t *heap = gt_slab_orphans;
+	if (heap)
+		gt_slab_orphans = heap->next_orphan;
+	gt_spin_unlock(&gt_slab_orphans_lock);
+	if (heap)
+		return heap;
+	/* never freed: slabs point back at their heap */
+	return ecalloc(sizeof(*heap));
+}
+
+void gt_slab_heap_put(gt_slab_heap_t *heap)
+{
+	gt_spin_lock(&gt_slab_orphans_lock);
+	heap->next_orphan = gt_slab_orphans;
+	gt_slab_orphans = heap;
+	gt_spin_unlock(&gt_slab_orphans_lock);
+}
+
+void *gt_slab_alloc(gt_slab_heap_t *heap, size_t size)
+{
+	int class = gt_slab_class(size);
+	if (class < 0)
+		fail("gt_slab_alloc: object too big");
+	gt_slab_cache_t *cache = &heap->caches[class];
+
+	struct gt_slab_obj *obj = cache->free;
+	if (!obj && cache->remote)
+		obj = __sync_lock_test_and_set(&cache->remote, NULL);
+	if (obj) {
+		cache->free = obj->next;
+		return obj;
+	}
+
+	size_t obj_size = (size_t) 1 << (GT_SLAB_MIN_SHIFT + class);
+	if (cache->bump + obj_size > cache->bump_end) {
+		gt_slab_t *slab = gt_slab_map();
+		slab->heap = heap;
+		slab->class = class;
+		cache->bump = (char *) slab + GT_SLAB_HDR_SIZE;
+		cache->bump_end = (char *) slab + GT_SLAB_SIZE;
+	}
+	void *p = cache->bump;
+	cache->bump += obj_size;
+	return p;
+}
+
+void gt_slab_free(gt_slab_heap_t *heap, void *obj)
+{
+	if (!obj)
+		return;
+	gt_slab_t *slab = gt_slab_of(obj);
+	gt_slab_cache_t *cache = &slab->heap->caches[slab->class];
+	struct gt_slab_obj *o = obj;
+
+	if (slab->heap == heap) {
+		o->next = cache->free;
+		cache->free = o;
+		return;
+	}
+
+	/* only the owner pops, and it takes the whole list, so there's no ABA
+	 * to worry about */
+	struct gt_slab_obj *head;
+	do {
+		head = cache->remote;
+		o->next = head;
+	} while (!__sync_bool_compare_and_swap(&cache->remote, head, o));
+}
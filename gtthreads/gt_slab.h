@@ -0,0 +1,58 @@
+/*
+ * gt_slab.h
+ *
+ * Slab caches for the library's small fixed-size objects: uthread
+ * descriptors, attrs and the schedulers' per-uthread data.
+ *
+ * Every kthread (and the application thread) owns a heap of per-size-class
+ * caches, which it allocates from and frees to without locking. Freeing an
+ * object owned by another heap pushes it onto that heap's lock-free remote
+ * list; the owner takes the whole list back in one swap once its own free
+ * list runs dry.
+ *
+ * Slabs are GT_SLAB_SIZE-aligned, so an object's owner is found by masking
+ * its address.
+ */
+
+#ifndef GT_SLAB_H_
+#define GT_SLAB_H_
+
+#include <stddef.h>
+
+#define GT_SLAB_SHIFT 16
+#define GT_SLAB_SIZE (1UL << GT_SLAB_SHIFT)	/* 64 KB */
+#define GT_SLAB_MIN_SHIFT 4
+#define GT_SLAB_CLASSES 8	/* 16 bytes ... 2 KB */
+
+struct gt_slab_obj;
+
+typedef struct gt_slab_cache {
+	struct gt_slab_obj *free;
+	/* pushed to by other heaps, drained by the owner */
+	struct gt_slab_obj *volatile remote;
+	/* carve new objects from here before mapping another slab */
+	char *bump;
+	char *bump_end;
+} gt_slab_cache_t;
+
+typedef struct gt_slab_heap {
+	gt_slab_cache_t caches[GT_SLAB_CLASSES];
+	struct gt_slab_heap *next_orphan;
+} gt_slab_heap_t;
+
+/* returns a heap for the calling kthread: one left behind by an exited
+ * kthread if there is one, else a new one */
+gt_slab_heap_t *gt_slab_heap_get(void);
+
+/* gives up the calling kthread's heap. Its objects stay valid and can still
+ * be freed; the next gt_slab_heap_get() takes them over */
+void gt_slab_heap_put(gt_slab_heap_t *heap);
+
+/* allocates `size` bytes from `heap`, which must be the caller's */
+void *gt_slab_alloc(gt_slab_heap_t *heap, size_t size);
+
+/* frees `obj` to `heap` if it came from there, to its owner's remote list
+ * otherwise */
+void gt_slab_free(gt_slab_heap_t *heap, void *obj);
+
+#endif /* GT_SLAB_H_ */
@@ -1,56 +1,187 @@
 /*
  * gt_spinlock.c
  *
+ * See gt_spinlock.h for the choice of implementations.
  */
 
-/* (http://www.intel.com/cd/ids/developer/asmo-na/eng/dc/threading/333935.htm)
- * With XCHG and CMPXCHG instructions, lock prefix is implicit when used with a
- * memory operand.
- * Also, spin-locking can be made more efficient by spinning on volatile(dirty) read
- * rather than spinning on atomic instructions (as in the link above). */
-
-/* Locking has no effect on uniprocessor. */
-/* CANT EXECUTE A BUS LOCKING INSTRUCTION FROM USER MODE SO THIS IS
- * THE BEST IMPLEMENTATION OF SPINLOCKS I COULD COME UP WITH
- * HAVE NO EFFECT ON A UNIPROCESSOR SYSTEM AS WE DONT NEED LOCKING THERE */
+#ifdef GT_LOCKSTAT
+#include <stdio.h>
+#include <string.h>
+#endif
 
 #include "gt_spinlock.h"
 
+const char gt_spinlock_name[] = GT_SPINLOCK_NAME;
+
+/* upper bound on the pauses between two looks at a contended lock */
+#define GT_SPIN_BACKOFF_MAX 1024
+
+static inline void gt_spin_pause(unsigned int n)
+{
+	while (n--)
+		__asm__ __volatile__ ("pause\n");
+}
+
 extern int gt_spinlock_init(gt_spinlock_t* spinlock)
 {
 	if(!spinlock)
 		return -1;
-	spinlock->locked = 0;
+	gt_spinlock_t unlocked = GT_SPINLOCK_INITIALIZER;
+	*spinlock = unlocked;
+	return 0;
+}
+
+extern int gt_spinlock_init_named(gt_spinlock_t* spinlock, const char *name)
+{
+	if (gt_spinlock_init(spinlock))
+		return -1;
+#ifdef GT_LOCKSTAT
+	spinlock->stat.name = name;
+#endif
 	return 0;
 }
 
-/* spinlock function with backoff */
-void gt_actual_spinlock(volatile int * spinlock)
+/* Each implementation below provides __gt_spin_lock(), which returns nonzero
+ * if it had to wait, and __gt_spin_unlock() */
+
+#if defined(GT_SPINLOCK_TICKET)
+
+static inline int __gt_spin_lock(gt_spinlock_t* spinlock)
 {
-	int sp_val = 1;
+	unsigned int ticket = __sync_fetch_and_add(&spinlock->next, 1);
+	unsigned int owner;
+	int waited = 0;
+	/* wait in proportion to the number of holders ahead of us */
+	while ((owner = __atomic_load_n(&spinlock->owner, __ATOMIC_ACQUIRE))
+	       != ticket) {
+		waited = 1;
+		gt_spin_pause(32 * (ticket - owner));
+	}
+	return waited;
+}
 
-	while(sp_val)
-	{
-		__asm__ __volatile__ ("pause\n");
-		if(!*((volatile int *)spinlock))
-		{
-		__asm__ __volatile__ (
-			"movl $0x01, %%eax\n"
-			"xchg %%eax, (%1)\n"
-			"movl %%eax, %0\n"
-			:"=m"(sp_val) /* 0 */
-			: "r"(spinlock) /* 1 */
-			: "%eax"); /* No modified flags or clobbered registers */
+static inline void __gt_spin_unlock(gt_spinlock_t *spinlock)
+{
+	/* only the holder writes owner */
+	__atomic_store_n(&spinlock->owner, spinlock->owner + 1,
+	                 __ATOMIC_RELEASE);
+}
+
+#elif defined(GT_SPINLOCK_MCS)
+
+#define GT_MCS_WAITING ((struct gt_mcs_node *) 1)
+
+static inline int __gt_spin_lock(gt_spinlock_t* spinlock)
+{
+	struct gt_mcs_node *q = &spinlock->q;
+	int waited = 0;
+	for (;; waited = 1) {
+		struct gt_mcs_node *prev = q->tail;
+		if (!prev) {
+			/* free: take it with nobody waiting */
+			if (__sync_bool_compare_and_swap(&q->tail, NULL, q))
+				return waited;
+			continue;
 		}
+
+		struct gt_mcs_node node = { GT_MCS_WAITING, NULL };
+		if (!__sync_bool_compare_and_swap(&q->tail, prev, &node))
+			continue;
+		prev->next = &node;
+		while (__atomic_load_n(&node.tail, __ATOMIC_ACQUIRE))
+			gt_spin_pause(1);
+
+		/* ours. Move the queue's head from our node, which is about
+		 * to go away, into the lock */
+		struct gt_mcs_node *succ = node.next;
+		if (!succ) {
+			q->next = NULL;
+			if (__sync_bool_compare_and_swap(&q->tail, &node, q))
+				return 1;
+			/* someone queued behind us meanwhile; wait for the
+			 * link */
+			while (!(succ = node.next))
+				gt_spin_pause(1);
+		}
+		q->next = succ;
+		return 1;
+	}
+}
+
+static inline void __gt_spin_unlock(gt_spinlock_t *spinlock)
+{
+	struct gt_mcs_node *q = &spinlock->q;
+	struct gt_mcs_node *succ = q->next;
+	if (!succ) {
+		if (__sync_bool_compare_and_swap(&q->tail, q, NULL))
+			return;
+		while (!(succ = q->next))
+			gt_spin_pause(1);
+	}
+	__atomic_store_n(&succ->tail, NULL, __ATOMIC_RELEASE);
+}
+
+#else /* GT_SPINLOCK_TTAS */
+
+static inline int __gt_spin_lock(gt_spinlock_t* spinlock)
+{
+	unsigned int backoff = 1;
+	int waited = 0;
+	/* only try the atomic swap when the lock looks free, and back off
+	 * further each time we lose */
+	while (spinlock->locked
+	       || __sync_lock_test_and_set(&spinlock->locked, 1)) {
+		waited = 1;
+		gt_spin_pause(backoff);
+		if (backoff < GT_SPIN_BACKOFF_MAX)
+			backoff <<= 1;
 	}
-	return;
+	return waited;
+}
+
+static inline void __gt_spin_unlock(gt_spinlock_t *spinlock)
+{
+	__sync_lock_release(&spinlock->locked);
+}
+
+#endif
+
+#ifdef GT_LOCKSTAT
+
+/* every named lock taken so far */
+static gt_spinlock_t *volatile gt_lockstat_locks;
+
+static inline unsigned long long gt_rdtsc(void)
+{
+	unsigned int lo, hi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((unsigned long long) hi << 32) | lo;
 }
 
 extern int gt_spin_lock(gt_spinlock_t* spinlock)
 {
 	if(!spinlock)
 		return -1;
-	gt_actual_spinlock(&(spinlock->locked));
+	unsigned long long start = gt_rdtsc();
+	int waited = __gt_spin_lock(spinlock);
+	struct gt_lockstat *stat = &spinlock->stat;
+	if (!stat->name)
+		return 0;
+
+	/* we hold the lock, so its counts are ours to update */
+	stat->acquired_at = gt_rdtsc();
+	stat->acquisitions++;
+	if (waited) {
+		stat->contended++;
+		stat->spin_cycles += stat->acquired_at - start;
+	}
+	if (!stat->listed) {
+		stat->listed = 1;
+		do {
+			stat->next = gt_lockstat_locks;
+		} while (!__sync_bool_compare_and_swap(&gt_lockstat_locks,
+		                                       stat->next, spinlock));
+	}
 	return 0;
 }
 
@@ -58,9 +189,72 @@ extern int gt_spin_unlock(gt_spinlock_t *spinlock)
 {
 	if(!spinlock)
 		return -1;
+	struct gt_lockstat *stat = &spinlock->stat;
+	if (stat->name) {
+		unsigned long long held = gt_rdtsc() - stat->acquired_at;
+		if (held > stat->max_hold_cycles)
+			stat->max_hold_cycles = held;
+	}
+	__gt_spin_unlock(spinlock);
+	return 0;
+}
+
+extern void gt_lockstat_dump(void)
+{
+	gt_spinlock_t *locks = __sync_lock_test_and_set(&gt_lockstat_locks,
+	                                                NULL);
+	fprintf(stderr, "%-20s %5s %12s %12s %6s %14s %12s\n", "lock",
+	        "count", "acquired", "contended", "%", "spin cycles",
+	        "max hold");
+	/* one line per name; there are only a few locks per kthread */
+	for (gt_spinlock_t *l = locks; l; l = l->stat.next) {
+		gt_spinlock_t *first = locks;
+		while (strcmp(first->stat.name, l->stat.name))
+			first = first->stat.next;
+		if (first != l)
+			continue; /* already printed */
 
-	if(spinlock->locked)
-		spinlock->locked = 0;
+		struct gt_lockstat sum = { .name = l->stat.name };
+		int count = 0;
+		for (gt_spinlock_t *m = l; m; m = m->stat.next) {
+			if (strcmp(m->stat.name, sum.name))
+				continue;
+			count++;
+			sum.acquisitions += m->stat.acquisitions;
+			sum.contended += m->stat.contended;
+			sum.spin_cycles += m->stat.spin_cycles;
+			if (m->stat.max_hold_cycles > sum.max_hold_cycles)
+				sum.max_hold_cycles = m->stat.max_hold_cycles;
+		}
+		fprintf(stderr, "%-20s %5d %12lu %12lu %6.2f %14llu %12llu\n",
+		        sum.name, count, sum.acquisitions, sum.contended,
+		        100.0 * sum.contended / sum.acquisitions,
+		        sum.spin_cycles, sum.max_hold_cycles);
+	}
+	for (gt_spinlock_t *l = locks, *next; l; l = next) {
+		next = l->stat.next;
+		const char *name = l->stat.name;
+		memset(&l->stat, 0, sizeof(l->stat));
+		l->stat.name = name;
+	}
+}
+
+#else
 
+extern int gt_spin_lock(gt_spinlock_t* spinlock)
+{
+	if(!spinlock)
+		return -1;
+	__gt_spin_lock(spinlock);
 	return 0;
 }
+
+extern int gt_spin_unlock(gt_spinlock_t *spinlock)
+{
+	if(!spinlock)
+		return -1;
+	__gt_spin_unlock(spinlock);
+	return 0;
+}
+
+#endif
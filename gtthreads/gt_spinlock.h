@@ -1,22 +1,122 @@
 /*
  * gt_spinlock.h
  *
+ * One spinlock API, three implementations, chosen at build time (see
+ * SPINLOCK in the Makefile):
+ *
+ * GT_SPINLOCK_TTAS (default): test-and-test-and-set with exponential backoff.
+ *   Cheapest uncontended; unfair.
+ * GT_SPINLOCK_TICKET: FIFO ticket lock, spinning in proportion to our place in
+ *   line. Fair, but every waiter polls the same line.
+ * GT_SPINLOCK_MCS: queued (MCS) lock in its K42 form, so no queue node has to
+ *   be passed around: a waiter spins on a node on its own stack, and the holder
+ *   keeps the head of the queue in the lock. Fair, each waiter spins on its own
+ *   line.
+ *
+ * All of them release with a store-release, and all are zero when unlocked.
+ * The fair ones hand the lock to a particular waiter, so with more kthreads
+ * than cpus every handoff can wait for the OS to run that waiter: they pay off
+ * only with a cpu per kthread.
+ *
+ * Building with GT_LOCKSTAT (make LOCKSTAT=1) makes every lock given a name
+ * count its acquisitions, how many of them had to wait, the cycles spent
+ * waiting and the longest hold. gtthread_app_exit() prints the counts, summed
+ * over the locks sharing a name, on stderr.
  */
 
 #ifndef GT_SPINLOCK_H_
 #define GT_SPINLOCK_H_
 
+#include <stddef.h>
+
+#if !defined(GT_SPINLOCK_TICKET) && !defined(GT_SPINLOCK_MCS) \
+        && !defined(GT_SPINLOCK_TTAS)
+#define GT_SPINLOCK_TTAS
+#endif
+
+#if defined(GT_SPINLOCK_TICKET)
+#define GT_SPINLOCK_VARIANT "ticket"
+#elif defined(GT_SPINLOCK_MCS)
+#define GT_SPINLOCK_VARIANT "mcs"
+#else
+#define GT_SPINLOCK_VARIANT "ttas"
+#endif
+
+#ifdef GT_LOCKSTAT
+#define GT_SPINLOCK_NAME GT_SPINLOCK_VARIANT "+lockstat"
+#else
+#define GT_SPINLOCK_NAME GT_SPINLOCK_VARIANT
+#endif
+
+#if defined(GT_SPINLOCK_MCS)
+struct gt_mcs_node {
+	/* in the lock: the last waiter, or the lock's own node while it is
+	 * held with nobody waiting. In a waiter: nonzero until it's our turn */
+	struct gt_mcs_node *volatile tail;
+	/* in the lock: the first waiter, kept by the holder. In a waiter: the
+	 * one behind us */
+	struct gt_mcs_node *volatile next;
+};
+#endif
+
+#ifdef GT_LOCKSTAT
+/* only ever written by the lock's holder, so it needs no atomics */
+struct gt_lockstat {
+	const char *name; /* NULL: not counted */
+	unsigned long acquisitions;
+	unsigned long contended; /* acquisitions that had to wait */
+	unsigned long long spin_cycles;
+	unsigned long long max_hold_cycles;
+	unsigned long long acquired_at;
+	struct gt_spinlock *next; /* in the list printed at exit */
+	int listed;
+};
+#endif
+
 typedef struct gt_spinlock
 {
+#if defined(GT_SPINLOCK_TICKET)
+	volatile unsigned int next; /* next ticket to hand out */
+	volatile unsigned int owner; /* ticket being served */
+#elif defined(GT_SPINLOCK_MCS)
+	struct gt_mcs_node q;
+#else
 	volatile int locked;
-	unsigned int holder;
+#endif
+#ifdef GT_LOCKSTAT
+	struct gt_lockstat stat;
+#endif
 } gt_spinlock_t;
 
-/* static initializer */
+/* static initializers */
+#if defined(GT_SPINLOCK_TICKET)
 #define GT_SPINLOCK_INITIALIZER {0, 0}
+#elif defined(GT_SPINLOCK_MCS)
+#define GT_SPINLOCK_INITIALIZER {{NULL, NULL}}
+#else
+#define GT_SPINLOCK_INITIALIZER {0}
+#endif
+#ifdef GT_LOCKSTAT
+#define GT_SPINLOCK_NAMED_INITIALIZER(lock_name) \
+	{ .stat = { .name = lock_name } }
+#else
+#define GT_SPINLOCK_NAMED_INITIALIZER(lock_name) GT_SPINLOCK_INITIALIZER
+#endif
+
+/* GT_SPINLOCK_NAME of the implementation the library was built with. The
+ * layout of gt_spinlock_t depends on it */
+extern const char gt_spinlock_name[];
 
 extern int gt_spinlock_init(gt_spinlock_t* spinlock);
+/* `name` is what GT_LOCKSTAT reports the lock under; it must outlive the lock */
+extern int gt_spinlock_init_named(gt_spinlock_t* spinlock, const char *name);
 extern int gt_spin_lock(gt_spinlock_t* spinlock);
 extern int gt_spin_unlock(gt_spinlock_t *spinlock);
 
+#ifdef GT_LOCKSTAT
+/* prints the counts of the named locks to stderr and forgets the locks, which
+ * may be freed afterwards */
+extern void gt_lockstat_dump(void);
+#endif
+
 #endif /* GT_SPINLOCK_H_ */
@@ -0,0 +1,107 @@
+/*
+ * gt_stack.c
+ *
+ * Guarded, recycled uthread stacks. See gt_stack.h
+ */
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "gt_stack.h"
+#include "gt_common.h"
+
+/* free stacks are linked through their own (unused) memory */
+struct gt_stack_free {
+	struct gt_stack_free *next;
+};
+
+static size_t gt_page_size(void)
+{
+	static size_t page_size = 0;
+	if (!page_size)
+		page_size = (size_t) sysconf(_SC_PAGESIZE);
+	return page_size;
+}
+
+/* returns the size class for `size`, or -1 if it is too big to cache */
+static int gt_stack_class(size_t size)
+{
+	int class = 0;
+	while (((size_t) 1 << (GT_STACK_MIN_SHIFT + class)) < size)
+		if (++class == GT_STACK_CLASSES)
+			return -1;
+	return class;
+}
+
+static void *gt_stack_map(size_t size)
+{
+	size_t guard = gt_page_size();
+	char *p = mmap(NULL, size + guard, PROT_READ | PROT_WRITE,
+	               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+		fail_perror("mmap");
+	if (mprotect(p, guard, PROT_NONE))
+		fail_perror("mprotect");
+	return p + guard;
+}
+
+static void gt_stack_unmap(void *stack, size_t size)
+{
+	size_t guard = gt_page_size();
+	if (munmap((char *) stack - guard, size + guard))
+		fail_perror("munmap");
+}
+
+void gt_stack_pool_init(gt_stack_pool_t *pool)
+{
+	for (int i = 0; i < GT_STACK_CLASSES; i++) {
+		pool->free[i] = NULL;
+		pool->free_count[i] = 0;
+	}
+}
+
+void gt_stack_pool_destroy(gt_stack_pool_t *pool)
+{
+	for (int i = 0; i < GT_STACK_CLASSES; i++) {
+		while (pool->free[i]) {
+			struct gt_stack_free *stack = pool->free[i];
+			pool->free[i] = stack->next;
+			gt_stack_unmap(stack,
+			               (size_t) 1 << (GT_STACK_MIN_SHIFT + i));
+		}
+		pool->free_count[i] = 0;
+	}
+}
+
+void *gt_stack_alloc(gt_stack_pool_t *pool, size_t *size)
+{
+	int class = gt_stack_class(*size);
+	if (class < 0) {
+		/* round to whole pages; not cached */
+		size_t page = gt_page_size();
+		*size = (*size + page - 1) & ~(page - 1);
+		return gt_stack_map(*size);
+	}
+
+	*size = (size_t) 1 << (GT_STACK_MIN_SHIFT + class);
+	struct gt_stack_free *stack = pool ? pool->free[class] : NULL;
+	if (!stack)
+		return gt_stack_map(*size);
+	pool->free[class] = stack->next;
+	pool->free_count[class]--;
+	return stack;
+}
+
+void gt_stack_free(gt_stack_pool_t *pool, void *stack, size_t size)
+{
+	int class = gt_stack_class(size);
+	if (class < 0 || pool->free_count[class] >= GT_STACK_POOL_MAX) {
+		gt_stack_unmap(stack, size);
+		return;
+	}
+
+	struct gt_stack_free *free_stack = stack;
+	free_stack->next = pool->free[class];
+	pool->free[class] = free_stack;
+	pool->free_count[class]++;
+}
@@ -0,0 +1,39 @@
+/*
+ * gt_stack.h
+ *
+ * Pools of mmap'd uthread stacks. Every stack has a PROT_NONE guard page
+ * below it, so overflowing it faults instead of scribbling on the neighbor.
+ * Stacks come in power-of-two size classes and are cached per class when
+ * freed. A pool is not locked: each kthread owns one.
+ */
+
+#ifndef GT_STACK_H_
+#define GT_STACK_H_
+
+#include <stddef.h>
+
+#define GT_STACK_MIN_SHIFT 14	/* smallest class is 16 KB */
+#define GT_STACK_CLASSES 8	/* ... the largest 2 MB */
+#define GT_STACK_POOL_MAX 64	/* stacks cached per class */
+
+struct gt_stack_free;
+
+typedef struct gt_stack_pool {
+	struct gt_stack_free *free[GT_STACK_CLASSES];
+	unsigned free_count[GT_STACK_CLASSES];
+} gt_stack_pool_t;
+
+void gt_stack_pool_init(gt_stack_pool_t *pool);
+
+/* unmaps every cached stack */
+void gt_stack_pool_destroy(gt_stack_pool_t *pool);
+
+/* returns the lowest usable address of a stack of at least `*size` bytes.
+ * `*size` is rounded up to the size actually handed out, which must be passed
+ * back to gt_stack_free(). A NULL `pool` always maps a fresh stack */
+void *gt_stack_alloc(gt_stack_pool_t *pool, size_t *size);
+
+/* returns a stack to `pool`, which needn't be the pool it came from */
+void gt_stack_free(gt_stack_pool_t *pool, void *stack, size_t size);
+
+#endif /* GT_STACK_H_ */
@@ -12,6 +12,7 @@
 #include <errno.h>
 
 #include "gt_thread.h"
+#include "gt_clock.h"
 #include "gt_kthread.h"
 #include "gt_uthread.h"
 #include "gt_common.h"
@@ -23,15 +24,15 @@
 extern scheduler_t scheduler;
 
 /* for thread-safe malloc */
-gt_spinlock_t MALLOC_LOCK = GT_SPINLOCK_INITIALIZER;
-
-/* used for keeping track of when to quit. kthreads decrement on exit */
-int kthread_count = 0;
-gt_spinlock_t kthread_count_lock = GT_SPINLOCK_INITIALIZER;
+gt_spinlock_t MALLOC_LOCK = GT_SPINLOCK_NAMED_INITIALIZER("MALLOC_LOCK");
 
 /* Global used to signal to the kthreads that they can exit when ready */
 extern int can_exit;
 
+/* every kthread, so we can wake and join them at exit */
+static kthread_t **kthreads;
+static int kthreads_length;
+
 void gtthread_options_init(gtthread_options_t *options)
 {
 	options->scheduler_type = SCHEDULER_DEFAULT;
@@ -64,45 +65,48 @@ static void _gtthread_app_init(gtthread_options_t *options)
 	if (options->lwp_count < 1) {
 		options->lwp_count = (int) sysconf(_SC_NPROCESSORS_CONF);
 	}
+	kthread_init_app_thread();
+	gt_clock_init();
 	scheduler_init(&scheduler, options->scheduler_type, options->lwp_count);
 
 	pid_t k_tid;
 	kthread_t *k_thread;
+	kthreads = ecalloc(options->lwp_count * sizeof(*kthreads));
 	for (int lwp = 0; lwp < options->lwp_count; lwp++) {
 		if (!(k_thread = kthread_create(&k_tid, lwp)))
 			fail_perror("kthread_create");
-		gt_spin_lock(&kthread_count_lock);
-		kthread_count++;
-		gt_spin_unlock(&kthread_count_lock);
+		kthreads[kthreads_length++] = k_thread;
 		checkpoint("k%d: created", lwp);
 	}
-}
-
-void wakeup(int signo)
-{
-	;
+	/* all kthreads come up in parallel; wait for the lot at once */
+	kthread_wait_ready(options->lwp_count);
 }
 
 void gtthread_app_exit()
 {
 	checkpoint("%s", "Entering app_exit");
 
-	/* be sure to wake from sleep */
-	sig_install_handler_and_unblock(SIGCHLD, wakeup);
+	/* the last uthread to finish wakes us */
+	uthread_wait_all();
 
-	/* first we signal to the kthreads that it is OK to exit. At this point,
-	 * they shouldn't need to wait for any more uthreads to be created */
+	/* then we signal to the kthreads that it is OK to exit. At this point,
+	 * nothing is left that could create more uthreads */
 	can_exit = 1;
-
-	gt_spin_lock(&kthread_count_lock);
-	while (kthread_count) {
-		checkpoint("%s", "Waiting for children");
-		gt_spin_unlock(&kthread_count_lock);
-		sleep(1);
-		gt_spin_lock(&kthread_count_lock);
-	}
-	gt_spin_unlock(&kthread_count_lock);
-
+	__sync_synchronize();
+	for (int i = 0; i < kthreads_length; i++)
+		kthread_unpark(kthreads[i]);
+
+	checkpoint("%s", "Waiting for children");
+	for (int i = 0; i < kthreads_length; i++)
+		kthread_join(kthreads[i]);
+	free(kthreads);
+	kthreads = NULL;
+	kthreads_length = 0;
+
+#ifdef GT_LOCKSTAT
+	/* while the scheduler's locks still exist */
+	gt_lockstat_dump();
+#endif
 	scheduler_destroy(&scheduler);
 	checkpoint("%s", "Exiting app");
 }
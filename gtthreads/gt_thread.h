@@ -5,6 +5,8 @@
 #ifndef GT_THREAD_H_
 #define GT_THREAD_H_
 
+#include <stddef.h>
+
 #include "gt_typedefs.h"
 
 struct timeval;
@@ -15,7 +17,8 @@ struct timeval;
 typedef enum scheduler_type {
 	SCHEDULER_DEFAULT,
 	SCHEDULER_PCS, /* priority co-scheduler */
-	SCHEDULER_CFS /* completely fair scheduler */
+	SCHEDULER_CFS, /* completely fair scheduler */
+	SCHEDULER_GANG /* PCS, with each group's uthreads run all at once */
 } scheduler_type_t;
 
 typedef struct gtthread_options {
@@ -42,7 +45,12 @@ void uthread_attr_destroy(uthread_attr_t *attr);
 void uthread_attr_init(uthread_attr_t *attr);
 
 /* Scheduling parameters. Either or both can be set to their defaults,
- * UTHREAD_ATTR_PRIORITY_DEFAULT and UTHREAD_ATTR_GROUP_DEFAULT, respectively */
+ * UTHREAD_ATTR_PRIORITY_DEFAULT and UTHREAD_ATTR_GROUP_DEFAULT, respectively.
+ * Lower priorities are favoured. PCS runs them strictly first, and takes
+ * priorities 0 to 63 and groups 0 to 255. CFS takes priorities 0 to 39 as a
+ * nice level plus 20, each step worth about 10% more or less cpu, and groups
+ * 0 to 31; it splits each kthread evenly among the groups with uthreads on it
+ * before weighing uthreads within a group */
 struct uthread_sched_param {
 	int priority;
 	uthread_gid group_id;
@@ -52,6 +60,11 @@ void uthread_attr_setschedparam(uthread_attr_t *attr,
 void uthread_attr_getschedparam(uthread_attr_t *attr,
                                 struct uthread_sched_param *param);
 
+/* Stack size for the uthread. Rounded up to the library's stack size classes;
+ * defaults to 16 KB. Overflowing the stack faults on a guard page */
+void uthread_attr_setstacksize(uthread_attr_t *attr, size_t stacksize);
+void uthread_attr_getstacksize(uthread_attr_t *attr, size_t *stacksize);
+
 /* Puts the total execution time for the uthread in `tv`, which does not include
  * the time spent waiting to be scheduled */
 void uthread_attr_getcputime(uthread_attr_t *attr, struct timeval *tv);
@@ -63,6 +76,19 @@ void uthread_attr_getcputime(uthread_attr_t *attr, struct timeval *tv);
 int uthread_create(uthread_tid *tid, uthread_attr_t *attr,
                    int(*start_routine)(void *), void *arg);
 
+/* creates `count` uthreads at once, the i-th starting start_routines[i](args[i])
+ * with its tid put in tids[i]. They share `attr`, or each gets the defaults if
+ * it is NULL. Cheaper than as many uthread_create()s: the tids are handed out
+ * together, each kthread's queue is taken once and each kthread woken once.
+ * Returns -1, having created none, if there aren't enough tids left */
+int uthread_create_many(uthread_tid *tids, uthread_attr_t *attr, int count,
+                        int(*start_routines[])(void *), void *args[]);
+
+/* returns 1 if the uthread named by `tid` is still running, 0 once it is
+ * done. The tids of finished uthreads are reused, but with a new generation,
+ * so a stale tid doesn't name the newcomer */
+int uthread_alive(uthread_tid tid);
+
 /* Voluntarily relinquishes the cpu for the currently executing uthread, and
  * causes the scheduling of the next uthread. */
 void gt_yield();
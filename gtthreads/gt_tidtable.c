@@ -0,0 +1,44 @@
+/*
+ * gt_tidtable.c
+ */
+
+#include <stdlib.h>
+
+#include "gt_tidtable.h"
+#include "gt_common.h"
+
+void gt_tidtable_init(gt_tidtable_t *table)
+{
+	for (int i = 0; i < GT_TIDTABLE_PAGES; i++)
+		table->pages[i] = NULL;
+}
+
+void gt_tidtable_destroy(gt_tidtable_t *table)
+{
+	for (int i = 0; i < GT_TIDTABLE_PAGES; i++) {
+		free(table->pages[i]);
+		table->pages[i] = NULL;
+	}
+}
+
+/* the page holding slot `index`, allocated if need be. Creators racing for a
+ * new page each allocate one; the first to install it wins and the others
+ * free theirs */
+static void **gt_tidtable_page(gt_tidtable_t *table, unsigned index)
+{
+	unsigned p = index >> GT_TIDTABLE_PAGE_BITS;
+	void **page = table->pages[p];
+	if (page)
+		return page;
+	void **fresh = ecalloc(GT_TIDTABLE_PAGE_SIZE * sizeof(*fresh));
+	if (__sync_bool_compare_and_swap(&table->pages[p], NULL, fresh))
+		return fresh;
+	efree(fresh);
+	return table->pages[p];
+}
+
+void gt_tidtable_set(gt_tidtable_t *table, unsigned index, void *entry)
+{
+	void **page = gt_tidtable_page(table, index);
+	page[index & (GT_TIDTABLE_PAGE_SIZE - 1)] = entry;
+}
@@ -0,0 +1,38 @@
+/*
+ * gt_tidtable.h
+ *
+ * Table of pointers indexed by tid slot (see uthread_tid_index()), readable
+ * from any kthread without a lock. It is paged: a fixed directory of pages,
+ * each allocated the first time a slot in it is set and never moved or freed
+ * until the table is, so a reader never sees an entry go away under it.
+ * Lookups are two loads, however many uthreads there are.
+ */
+
+#ifndef GT_TIDTABLE_H_
+#define GT_TIDTABLE_H_
+
+#include "gt_uthread.h"
+
+/* 4096 pages of 4096 entries: a 32 KB directory covers UTHREAD_MAX_LIVE */
+#define GT_TIDTABLE_PAGE_BITS 12
+#define GT_TIDTABLE_PAGE_SIZE (1U << GT_TIDTABLE_PAGE_BITS)
+#define GT_TIDTABLE_PAGES (UTHREAD_MAX_LIVE / GT_TIDTABLE_PAGE_SIZE)
+
+typedef struct gt_tidtable {
+	void **volatile pages[GT_TIDTABLE_PAGES];
+} gt_tidtable_t;
+
+void gt_tidtable_init(gt_tidtable_t *table);
+void gt_tidtable_destroy(gt_tidtable_t *table);
+/* sets the entry of slot `index`, from any kthread. Each slot must have a
+ * single writer at a time */
+void gt_tidtable_set(gt_tidtable_t *table, unsigned index, void *entry);
+
+/* the entry of slot `index`, which must have been set */
+static inline void *gt_tidtable_get(gt_tidtable_t *table, unsigned index)
+{
+	return table->pages[index >> GT_TIDTABLE_PAGE_BITS]
+	        [index & (GT_TIDTABLE_PAGE_SIZE - 1)];
+}
+
+#endif /* GT_TIDTABLE_H_ */
@@ -0,0 +1,91 @@
+/*
+ * gt_timeline.h
+ *
+ * The CFS timeline: runnable uthreads ordered by vruntime. CFS only inserts,
+ * looks at the minimum and takes it out, so any of three structures will do,
+ * chosen at build time (see TIMELINE in the Makefile):
+ *
+ * GT_TIMELINE_RBTREE (default): gt_rbtree.h. O(log n) insert and delete-min,
+ *   minimum cached.
+ * GT_TIMELINE_PAIRING: gt_pheap.h. O(1) insert, amortized O(log n)
+ *   delete-min.
+ * GT_TIMELINE_RADIX: gt_radixheap.h. O(1) insert, amortized O(log range)
+ *   delete-min. Monotone: a key below the last one taken out is raised to it,
+ *   much as CFS never places a uthread before min_vruntime.
+ *
+ * The node is embedded in the caller's object; gt_timeline_entry() gets the
+ * object back. gtbench/timelinebench compares all three.
+ */
+
+#ifndef GT_TIMELINE_H_
+#define GT_TIMELINE_H_
+
+#include <stddef.h>
+
+#if !defined(GT_TIMELINE_PAIRING) && !defined(GT_TIMELINE_RADIX) \
+        && !defined(GT_TIMELINE_RBTREE)
+#define GT_TIMELINE_RBTREE
+#endif
+
+#if defined(GT_TIMELINE_PAIRING)
+
+#include "gt_pheap.h"
+#define GT_TIMELINE_NAME "pairing"
+typedef gt_ph_node_t gt_timeline_node_t;
+typedef gt_pheap_t gt_timeline_t;
+#define __gt_tl(op) gt_ph_##op
+
+#elif defined(GT_TIMELINE_RADIX)
+
+#include "gt_radixheap.h"
+#define GT_TIMELINE_NAME "radix"
+typedef gt_rh_node_t gt_timeline_node_t;
+typedef gt_radixheap_t gt_timeline_t;
+#define __gt_tl(op) gt_rh_##op
+
+#else
+
+#include "gt_rbtree.h"
+#define GT_TIMELINE_NAME "rbtree"
+typedef gt_rb_node_t gt_timeline_node_t;
+typedef gt_rb_tree_t gt_timeline_t;
+#define __gt_tl(op) gt_rb_##op
+
+#endif
+
+#define gt_timeline_entry(ptr, type, member) \
+	((type *) ((char *) (ptr) - offsetof(type, member)))
+
+static inline void gt_timeline_init(gt_timeline_t *timeline)
+{
+	__gt_tl(init)(timeline);
+}
+
+/* set node->key first */
+static inline void gt_timeline_insert(gt_timeline_t *timeline,
+                                      gt_timeline_node_t *node)
+{
+	__gt_tl(insert)(timeline, node);
+}
+
+static inline int gt_timeline_empty(gt_timeline_t *timeline)
+{
+	return __gt_tl(empty)(timeline);
+}
+
+/* the node with the smallest key, NULL if empty */
+static inline gt_timeline_node_t *gt_timeline_first(gt_timeline_t *timeline)
+{
+	return __gt_tl(first)(timeline);
+}
+
+/* removes and returns the node with the smallest key, NULL if empty */
+static inline gt_timeline_node_t *gt_timeline_delete_min(
+        gt_timeline_t *timeline)
+{
+	return __gt_tl(delete_min)(timeline);
+}
+
+#undef __gt_tl
+
+#endif /* GT_TIMELINE_H_ */
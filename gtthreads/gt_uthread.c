@@ -6,10 +6,11 @@
 #define _GNU_SOURCE
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
 #include <assert.h>
 #include <sched.h>
 #include <string.h>
-#include <ucontext.h>
 
 #include "gt_uthread.h"
 #include "gt_kthread.h"
@@ -19,112 +20,319 @@
 #include "gt_scheduler.h"
 #include "gt_signal.h"
 
-#define UTHREAD_DEFAULT_SSIZE (16 * 1024 )
-
 /* global scheduler */
 extern scheduler_t scheduler;
 
-gt_spinlock_t uthread_count_lock = GT_SPINLOCK_INITIALIZER;
-int uthread_count = 0;
+/* tid slots. Freed slots are queued and reused oldest first, each time with
+ * the generation bumped, so a stale tid goes on failing to name anyone for as
+ * long as possible. All under uthread_tid_lock */
+#define UTHREAD_TID_SLOTS_DEFAULT 32
+#define UTHREAD_TID_NONE UINT_MAX
+
+typedef struct uthread_tid_slot {
+	uthread_t *uthread; /* NULL while free */
+	unsigned generation;
+	unsigned next_free;
+} uthread_tid_slot_t;
 
-gt_spinlock_t uthread_init_lock = GT_SPINLOCK_INITIALIZER;
+static gt_spinlock_t uthread_tid_lock =
+	GT_SPINLOCK_NAMED_INITIALIZER("uthread_tid");
+static uthread_tid_slot_t *uthread_tid_slots = NULL;
+static unsigned uthread_tid_slots_length = 0;
+static unsigned uthread_tid_slots_used = 0;
+static unsigned uthread_tid_slots_free = 0; /* queued for reuse */
+static unsigned uthread_tid_free_head = UTHREAD_TID_NONE;
+static unsigned uthread_tid_free_tail = UTHREAD_TID_NONE;
+
+/* uthreads created but not yet done. The one taking it to 0 wakes
+ * uthread_wait_all() */
+static volatile int uthread_live_count = 0;
 
 /* Serves as the launching off point and landing point for the user's uthread
  * execution.
  *
- * Does the initial setjmp so, on the first schedule, the user's
- * function is called (afterwards, execution is resumed by returning from signal
- * handlers). Also, uthreads end up here when the finish the user's function;
- * so this function launches back into the schedule() to schedule the next
- * available uthread.
+ * gt_context_make() points new uthreads here so, on the first schedule, the
+ * user's function is called (afterwards, schedule() resumes the uthread by
+ * switching back to where it left off in kthread_preempt_current()). Also,
+ * uthreads end up here when they finish the user's function; so this
+ * function launches back into the schedule() to schedule the next available
+ * uthread.
  */
-void uthread_context_func(int signo)
+void uthread_context_func(void)
 {
 	kthread_t *kthread = kthread_current_kthread();
 	uthread_t *uthread = kthread->current_uthread;
 	checkpoint("k%d: u%d: uthread_context_func .....",
 	           kthread->cpuid, uthread->tid);
 
+	/* first time on the cpu: we may have been switched to from inside the
+	 * SIGSCHED handler of the previous uthread */
+	kthread->in_scheduler = 0;
+	kthread_sched_signal_restore(kthread);
+
 	/* Execute the new_uthread task */
-	while(gettimeofday(&uthread->attr->timeslice_start, NULL));
-	checkpoint("u%d: Start time: %ld.%06ld s", uthread->tid,
-	           uthread->attr->timeslice_start.tv_sec,
-	           uthread->attr->timeslice_start.tv_usec);
+	if (kthread_current_kthread()->preempt_pending)
+		kthread_preempt_current(kthread_enter_scheduler());
 	uthread->state = UTHREAD_RUNNING;
 	uthread->start_routine(uthread->arg);
-	uthread->state = UTHREAD_DONE;
-	checkpoint("u%d: getting final elapsed time", uthread->tid);
-	uthread_attr_set_elapsed_cpu_time(uthread->attr);
 
+	/* from here on we stay put: a preemption would leave us half done */
+	kthread = uthread_preempt_disable();
+	uthread->state = UTHREAD_DONE;
 	checkpoint("u%d: task ended normally", uthread->tid);
+	if (!__sync_sub_and_fetch(&uthread_live_count, 1))
+		syscall(SYS_futex, &uthread_live_count, FUTEX_WAKE_PRIVATE,
+		        INT_MAX, NULL, NULL, 0);
 
 	/* schedule the next thread, if there is one */
-	schedule();
-
-	checkpoint("%s", "exiting context fcn");
-	return;
+	kthread_finish_current(kthread);
 }
 
-/* Initializes uthread. Sets up a stack through the use of SIGUSR2. Must be
- * called *after* the kthread it is going to be scheduled on has been
- * initialized  */
-int uthread_makecontext(uthread_t *uthread)
+/* Initializes uthread. Sets up a stack and points the context at
+ * uthread_context_func(). `k_ctx` is the calling kthread, in schedule() */
+int uthread_makecontext(uthread_t *uthread, kthread_t *k_ctx)
 {
 	checkpoint("u%d: Initializing uthread...", uthread->tid);
 
-	/* Initialize new context for uthread */
-	ucontext_t *u_ctx = &uthread->context;
-	if (getcontext(u_ctx) == -1)
-		fail_perror("getcontext");
-	u_ctx->uc_stack.ss_size = UTHREAD_DEFAULT_SSIZE;
-	u_ctx->uc_stack.ss_sp = emalloc(u_ctx->uc_stack.ss_size);
-	u_ctx->uc_stack.ss_flags = 0;
-	u_ctx->uc_link = NULL;
-	makecontext(u_ctx, (void (*)(void)) uthread_context_func, 1, 0);
+	/* Initialize new context for uthread, on a stack from our kthread's
+	 * pool */
+	uthread->stack_size = uthread->attr->stack_size;
+	uthread->stack = gt_stack_alloc(&k_ctx->stack_pool,
+	                                &uthread->stack_size);
+	gt_context_make(&uthread->context, uthread->stack, uthread->stack_size,
+	                uthread_context_func);
 	checkpoint("u%d: initialized", uthread->tid);
 	return 0;
 }
 
+/* hands out a tid for `uthread`, or returns UTHREAD_TID_NONE if
+ * UTHREAD_MAX_LIVE uthreads are alive. Called with uthread_tid_lock held */
+static uthread_tid uthread_tid_take(uthread_t *uthread)
+{
+	unsigned index;
+	if ((index = uthread_tid_free_head) != UTHREAD_TID_NONE) {
+		uthread_tid_free_head = uthread_tid_slots[index].next_free;
+		if (uthread_tid_free_head == UTHREAD_TID_NONE)
+			uthread_tid_free_tail = UTHREAD_TID_NONE;
+		uthread_tid_slots_free--;
+	} else if (uthread_tid_slots_used < UTHREAD_MAX_LIVE) {
+		if (uthread_tid_slots_used == uthread_tid_slots_length) {
+			uthread_tid_slots_length = uthread_tid_slots_length
+			        ? 2 * uthread_tid_slots_length
+			        : UTHREAD_TID_SLOTS_DEFAULT;
+			uthread_tid_slots = erealloc(uthread_tid_slots,
+			        uthread_tid_slots_length
+			        * sizeof(*uthread_tid_slots));
+		}
+		index = uthread_tid_slots_used++;
+		uthread_tid_slots[index].generation = 0;
+	} else {
+		return UTHREAD_TID_NONE;
+	}
+	uthread_tid_slot_t *slot = &uthread_tid_slots[index];
+	slot->uthread = uthread;
+	return (slot->generation << UTHREAD_TID_INDEX_BITS) | index;
+}
 
-int uthread_create(uthread_tid *u_tid, uthread_attr_t *attr,
-                   int(*start_routine)(void *), void *arg)
+static uthread_tid uthread_tid_alloc(uthread_t *uthread)
 {
-	if (attr == NULL) {
-		attr = uthread_attr_create();
-		uthread_attr_init(attr);
+	gt_spin_lock(&uthread_tid_lock);
+	uthread_tid tid = uthread_tid_take(uthread);
+	gt_spin_unlock(&uthread_tid_lock);
+	return tid;
+}
+
+/* hands out tids for all `count` uthreads, under one acquisition of
+ * uthread_tid_lock, or none at all and returns -1 if there aren't enough */
+static int uthread_tid_alloc_many(uthread_t **uthreads, int count)
+{
+	gt_spin_lock(&uthread_tid_lock);
+	if ((unsigned) count > uthread_tid_slots_free
+	                       + (UTHREAD_MAX_LIVE - uthread_tid_slots_used)) {
+		gt_spin_unlock(&uthread_tid_lock);
+		return -1;
 	}
+	for (int i = 0; i < count; i++)
+		uthreads[i]->tid = uthread_tid_take(uthreads[i]);
+	gt_spin_unlock(&uthread_tid_lock);
+	return 0;
+}
 
-	checkpoint("%s", "Creating uthread...");
-	uthread_t *new_uthread = ecalloc(sizeof(*new_uthread));
+static void uthread_tid_free(uthread_tid tid)
+{
+	unsigned index = uthread_tid_index(tid);
+	gt_spin_lock(&uthread_tid_lock);
+	uthread_tid_slot_t *slot = &uthread_tid_slots[index];
+	slot->uthread = NULL;
+	slot->generation = (slot->generation + 1)
+	        & (UINT_MAX >> UTHREAD_TID_INDEX_BITS);
+	slot->next_free = UTHREAD_TID_NONE;
+	if (uthread_tid_free_tail == UTHREAD_TID_NONE)
+		uthread_tid_free_head = index;
+	else
+		uthread_tid_slots[uthread_tid_free_tail].next_free = index;
+	uthread_tid_free_tail = index;
+	uthread_tid_slots_free++;
+	gt_spin_unlock(&uthread_tid_lock);
+}
+
+int uthread_alive(uthread_tid tid)
+{
+	unsigned index = uthread_tid_index(tid);
+	kthread_t *k_ctx = uthread_preempt_disable();
+	int alive = 0;
+	gt_spin_lock(&uthread_tid_lock);
+	if (index < uthread_tid_slots_used) {
+		uthread_t *uthread = uthread_tid_slots[index].uthread;
+		alive = uthread && uthread->tid == tid
+		        && uthread->state != UTHREAD_DONE;
+	}
+	gt_spin_unlock(&uthread_tid_lock);
+	uthread_preempt_enable(k_ctx);
+	return alive;
+}
+
+void uthread_reap(uthread_t *uthread, kthread_t *k_ctx)
+{
+	checkpoint("k%d: u%d: reaping, execution time %llu ns", k_ctx->cpuid,
+	           uthread->tid, uthread->attr->execution_ns);
+	gt_stack_free(&k_ctx->stack_pool, uthread->stack, uthread->stack_size);
+	if (scheduler.reap_uthread)
+		scheduler.reap_uthread(k_ctx, uthread);
+	if (uthread->owns_attr)
+		gt_slab_free(k_ctx->slab_heap, uthread->attr);
+	uthread_tid_free(uthread->tid);
+	gt_slab_free(k_ctx->slab_heap, uthread);
+}
+
+
+/* a new uthread starting at start_routine(arg), with `attr` or else an attr
+ * of its own with the defaults */
+static uthread_t *uthread_new(uthread_attr_t *attr,
+                              int(*start_routine)(void *), void *arg)
+{
+	uthread_t *new_uthread = kthread_slab_calloc(sizeof(*new_uthread));
 	new_uthread->state = UTHREAD_INIT;
 	new_uthread->start_routine = start_routine;
 	new_uthread->arg = arg;
+	if (attr == NULL) {
+		attr = uthread_attr_create();
+		uthread_attr_init(attr);
+		new_uthread->owns_attr = 1;
+	}
 	new_uthread->attr = attr;
+	return new_uthread;
+}
 
-	gt_spin_lock(&uthread_count_lock);
-	new_uthread->tid = uthread_count++;
-	gt_spin_unlock(&uthread_count_lock);
+static void uthread_delete(uthread_t *uthread)
+{
+	if (uthread->owns_attr)
+		uthread_attr_destroy(uthread->attr);
+	kthread_slab_free(uthread);
+}
+
+int uthread_create(uthread_tid *u_tid, uthread_attr_t *attr,
+                   int(*start_routine)(void *), void *arg)
+{
+	checkpoint("%s", "Creating uthread...");
+	uthread_t *new_uthread = uthread_new(attr, start_routine, arg);
+
+	/* we take the scheduler's locks, which it takes too: don't get
+	 * preempted holding them */
+	kthread_t *k_ctx = uthread_preempt_disable();
+	if ((new_uthread->tid = uthread_tid_alloc(new_uthread))
+	    == UTHREAD_TID_NONE) {
+		uthread_preempt_enable(k_ctx);
+		uthread_delete(new_uthread);
+		return -1;
+	}
 	*u_tid = new_uthread->tid;
 
+	/* the stack and context come when a kthread first picks us: see
+	 * schedule() */
 	new_uthread->state = UTHREAD_RUNNABLE;
+	__sync_add_and_fetch(&uthread_live_count, 1);
 	kthread_t *kthread = scheduler.uthread_init(new_uthread);
 	assert(kthread != NULL);
-	uthread_makecontext(new_uthread);
-	if (kthread->state != KTHREAD_RUNNING) {
-		/* our kthread is waiting for its first uthread. wake it up */
-		checkpoint("u%d: k%d: Sending SIGSCHED to kthread",
-			   new_uthread->tid, kthread->cpuid);
-		kill(kthread->tid, SIGSCHED);
+	uthread_preempt_enable(k_ctx);
+	/* wake our kthread if it is waiting for a uthread, or has no timer
+	 * running to ever get around to us */
+	kthread_kick(kthread);
+	checkpoint("u%d: created", *u_tid);
+	return 0;
+}
+
+int uthread_create_many(uthread_tid *u_tids, uthread_attr_t *attr, int count,
+                        int(*start_routines[])(void *), void *args[])
+{
+	checkpoint("Creating %d uthreads...", count);
+	if (count <= 0)
+		return count ? -1 : 0;
+
+	/* as in uthread_create(), and the arrays come from malloc, which must
+	 * not be preempted either */
+	kthread_t *k_ctx = uthread_preempt_disable();
+	uthread_t **batch = emalloc(count * sizeof(*batch));
+	for (int i = 0; i < count; i++)
+		batch[i] = uthread_new(attr, start_routines[i], args[i]);
+	if (uthread_tid_alloc_many(batch, count)) {
+		for (int i = 0; i < count; i++)
+			uthread_delete(batch[i]);
+		efree(batch);
+		uthread_preempt_enable(k_ctx);
+		return -1;
 	}
-	checkpoint("u%d: created", new_uthread->tid);
+	for (int i = 0; i < count; i++) {
+		u_tids[i] = batch[i]->tid;
+		batch[i]->state = UTHREAD_RUNNABLE;
+	}
+	__sync_add_and_fetch(&uthread_live_count, count);
+
+	kthread_t **kthreads = emalloc(count * sizeof(*kthreads));
+	if (scheduler.uthread_init_many) {
+		scheduler.uthread_init_many(batch, count, kthreads);
+	} else {
+		for (int i = 0; i < count; i++)
+			kthreads[i] = scheduler.uthread_init(batch[i]);
+	}
+	/* each kthread that got some is kicked once; the distinct ones are
+	 * gathered at the front of `kthreads` */
+	int kicks = 0;
+	for (int i = 0; i < count; i++) {
+		int j = 0;
+		while (j < kicks && kthreads[j] != kthreads[i])
+			j++;
+		if (j == kicks)
+			kthreads[kicks++] = kthreads[i];
+	}
+	/* kicking our own kthread just leaves a preemption pending until we
+	 * enable them again, after the arrays are freed */
+	for (int i = 0; i < kicks; i++)
+		kthread_kick(kthreads[i]);
+	efree(batch);
+	efree(kthreads);
+	uthread_preempt_enable(k_ctx);
+	checkpoint("%d uthreads created on %d kthreads", count, kicks);
 	return 0;
 }
 
-/* Suspends the currently running uthread and causes the next to be scheduled */
+void uthread_wait_all(void)
+{
+	int live;
+	while ((live = uthread_live_count))
+		syscall(SYS_futex, &uthread_live_count, FUTEX_WAIT_PRIVATE,
+		        live, NULL, NULL, 0);
+}
+
+/* Suspends the currently running uthread and causes the next to be scheduled.
+ * Goes straight into the scheduler rather than raising SIGSCHED, so a yield
+ * never enters the kernel */
 void uthread_yield()
 {
-	checkpoint("k%d: u%d: Yielding",
-	           (kthread_current_kthread())->cpuid,
-	           (kthread_current_kthread())->current_uthread->tid);
-	kill(getpid(), SIGSCHED);
+	kthread_t *k_ctx = kthread_enter_scheduler();
+	uthread_t *uthread = k_ctx->current_uthread;
+	checkpoint("k%d: u%d: Yielding", k_ctx->cpuid, uthread->tid);
+	uthread->yielded = 1;
+	kthread_preempt_current(k_ctx);
+	uthread->yielded = 0;
 }
@@ -9,23 +9,30 @@
 #include <setjmp.h>
 #include <signal.h>
 #include <sys/time.h>
-#include <ucontext.h>
+#include <stddef.h>
 
 #include "gt_typedefs.h"
+#include "gt_context.h"
+#include "gt_kthread.h"
 
 /* schedulers should detect and correct these defaults */
 #define UTHREAD_ATTR_PRIORITY_DEFAULT -1
 #define UTHREAD_ATTR_GROUP_DEFAULT -1
+#define UTHREAD_ATTR_STACKSIZE_DEFAULT (16 * 1024)
+
+/* a tid is a slot index in its low UTHREAD_TID_INDEX_BITS, tagged with the
+ * slot's generation in the other 8. See uthread_tid_index(). At most
+ * UTHREAD_MAX_LIVE (16M) uthreads are alive at once */
+#define UTHREAD_TID_INDEX_BITS 24
+#define UTHREAD_MAX_LIVE (1U << UTHREAD_TID_INDEX_BITS)
 
 struct uthread_attr {
 	int priority;
 	uthread_gid group_id;
-	struct timeval execution_time;
-	struct timeval timeslice_start; // last time of day, used for bookkeeping
+	size_t stack_size;
+	unsigned long long execution_ns; // cpu time of all finished slices
 };
 
-void uthread_attr_set_elapsed_cpu_time(struct uthread_attr *attr);
-
 
 enum uthread_state {
 	UTHREAD_INIT,
@@ -38,17 +45,107 @@ typedef struct uthread {
 	uthread_tid tid;
 	enum uthread_state state;
 	struct uthread_attr *attr;
+	int owns_attr; /* attr was made by uthread_create(); reap it with us */
 	int (*start_routine)(void *);
 	void *arg;
+	/* nonzero while the uthread must not be preempted (and so must not
+	 * move to another kthread). See uthread_preempt_disable() */
+	volatile sig_atomic_t preempt_disabled;
+
+	gt_context_t context;
+	void *stack;
+	size_t stack_size;
 
-	ucontext_t context;
+	/* see uthread_slice_begin() */
+	unsigned long long slice_start_ns;
+	unsigned long long last_slice_ns;
+	/* set while uthread_yield() switches out, so the scheduler can tell a
+	 * slice given up from one cut short by SIGSCHED */
+	int yielded;
 } uthread_t;
 
 int uthread_init(uthread_t *uthread);
 
+/* gives a uthread that has never run its stack, from `k_ctx`'s pool, and its
+ * starting context. Called by schedule() on the kthread about to run it */
+int uthread_makecontext(uthread_t *uthread, kthread_t *k_ctx);
+
+/* Blocks until every uthread created so far is done */
+void uthread_wait_all(void);
+
 /* Suspends the currently running uthread and causes the next to be scheduled */
 void uthread_yield();
 
-void uthread_context_func(int signo);
+void uthread_context_func(void);
+
+/* frees everything a finished uthread held: its stack (back to `k_ctx`'s
+ * pool), the scheduler's data for it, its attr if it owns it, the descriptor
+ * and its tid. Called by schedule(), which must be off the uthread's stack */
+void uthread_reap(uthread_t *uthread, kthread_t *k_ctx);
+
+/* Inlines */
+/* returns the slot of `tid`, which stays below the peak number of live
+ * uthreads, so schedulers can index arrays by it */
+static inline unsigned uthread_tid_index(uthread_tid tid)
+{
+	return tid & (UTHREAD_MAX_LIVE - 1);
+}
+
+/* returns the uthread running on the calling kthread, NULL outside of one.
+ * A single %gs-relative load, so a preemption can't land between finding our
+ * kthread and reading its current uthread */
+static inline uthread_t *uthread_current(void)
+{
+	uthread_t *uthread;
+	__asm__ __volatile__ ("movq %%gs:%c1, %0"
+	                      : "=r" (uthread)
+	                      : "i" (offsetof(kthread_t, current_uthread)));
+	return uthread;
+}
+
+/* Keeps the calling uthread on its kthread until the matching
+ * uthread_preempt_enable(); SIGSCHED is deferred meanwhile. Calls nest.
+ * Returns that kthread, which is safe to use for per-kthread data until then.
+ * NULL outside of a kthread */
+static inline kthread_t *uthread_preempt_disable(void)
+{
+	uthread_t *uthread = uthread_current();
+	if (uthread)
+		uthread->preempt_disabled++;
+	__asm__ __volatile__ ("" : : : "memory");
+	return kthread_current_kthread();
+}
+
+static inline void uthread_preempt_enable(kthread_t *k_ctx)
+{
+	if (!k_ctx || !k_ctx->current_uthread)
+		return;
+	__asm__ __volatile__ ("" : : : "memory");
+	if (--k_ctx->current_uthread->preempt_disabled)
+		return;
+	__asm__ __volatile__ ("" : : : "memory");
+	/* preemptible again, so we may have moved: look again. A move after
+	 * looking just costs a spurious switch */
+	if (kthread_current_kthread()->preempt_pending)
+		kthread_preempt_current(kthread_enter_scheduler());
+}
+
+/* A slice is a uthread's stretch on the cpu, from being switched in to being
+ * switched out, timed with gt_clock_ns(). schedule() reads the clock once per
+ * switch, into k_ctx->switch_ns, which ends one slice and begins the next.
+ * The end charges the slice to the uthread's execution time and leaves it in
+ * last_slice_ns, for the scheduler */
+static inline void uthread_slice_begin(uthread_t *uthread,
+                                       unsigned long long now)
+{
+	uthread->slice_start_ns = now;
+}
+
+static inline void uthread_slice_end(uthread_t *uthread,
+                                     unsigned long long now)
+{
+	uthread->last_slice_ns = now - uthread->slice_start_ns;
+	uthread->attr->execution_ns += uthread->last_slice_ns;
+}
 
 #endif /* GT_UTHREAD_H_ */
@@ -14,8 +14,8 @@
 
 void uthread_attr_getcputime(uthread_attr_t *attr, struct timeval *tv)
 {
-	tv->tv_sec = attr->execution_time.tv_sec;
-	tv->tv_usec = attr->execution_time.tv_usec;
+	tv->tv_sec = attr->execution_ns / 1000000000;
+	tv->tv_usec = attr->execution_ns % 1000000000 / 1000;
 }
 
 void uthread_attr_getschedparam(uthread_attr_t *attr,
@@ -32,73 +32,31 @@ void uthread_attr_setschedparam(uthread_attr_t *attr,
 	attr->group_id = param->group_id;
 }
 
-void uthread_attr_init(uthread_attr_t *attr)
+void uthread_attr_getstacksize(uthread_attr_t *attr, size_t *stacksize)
 {
-	attr->priority = UTHREAD_ATTR_PRIORITY_DEFAULT;
-	attr->group_id = UTHREAD_ATTR_GROUP_DEFAULT;
-	attr->execution_time.tv_sec = 0;
-	attr->execution_time.tv_usec = 0;
-	attr->timeslice_start = attr->execution_time;
+	*stacksize = attr->stack_size;
 }
 
-uthread_attr_t *uthread_attr_create()
-{
-	uthread_attr_t *attr = emalloc(sizeof(*attr));
-	return attr;
-}
-
-void uthread_attr_destroy(uthread_attr_t *attr)
+void uthread_attr_setstacksize(uthread_attr_t *attr, size_t stacksize)
 {
-	free(attr);
+	attr->stack_size = stacksize;
 }
 
-/* performs "final - initial", puts result in `result`. returns 1 if answer is negative,
- * 0 otherwise. taken from gnu.org */
-static int timeval_subtract(struct timeval *result, struct timeval *final,
-                            struct timeval *initial)
+void uthread_attr_init(uthread_attr_t *attr)
 {
-	/* Perform the carry for the later subtraction by updating y. */
-	if (final->tv_usec < initial->tv_usec) {
-		int nsec = (initial->tv_usec - final->tv_usec) / 1000000 + 1;
-		initial->tv_usec -= 1000000 * nsec;
-		initial->tv_sec += nsec;
-	}
-	if (final->tv_usec - initial->tv_usec > 1000000) {
-		int nsec = (final->tv_usec - initial->tv_usec) / 1000000;
-		initial->tv_usec += 1000000 * nsec;
-		initial->tv_sec -= nsec;
-	}
-
-	/* Compute the time remaining to wait. tv_usec is certainly positive. */
-	result->tv_sec = final->tv_sec - initial->tv_sec;
-	result->tv_usec = final->tv_usec - initial->tv_usec;
-
-	/* Return 1 if result is negative. */
-	return final->tv_sec < initial->tv_sec;
+	attr->priority = UTHREAD_ATTR_PRIORITY_DEFAULT;
+	attr->group_id = UTHREAD_ATTR_GROUP_DEFAULT;
+	attr->stack_size = UTHREAD_ATTR_STACKSIZE_DEFAULT;
+	attr->execution_ns = 0;
 }
 
-/* adds `a` and `b`, puts result in `result`. Assumes both `a` and `b` are positive */
-static void timeval_add(struct timeval *result, struct timeval *a, struct timeval *b)
+uthread_attr_t *uthread_attr_create()
 {
-	result->tv_sec = a->tv_sec + b->tv_sec;
-	result->tv_usec = a->tv_usec + b->tv_usec;
-	while (result->tv_usec > 1000000) {
-		result->tv_usec -= 1000000;
-		result->tv_sec++;
-	}
+	uthread_attr_t *attr = kthread_slab_alloc(sizeof(*attr));
+	return attr;
 }
 
-void uthread_attr_set_elapsed_cpu_time(uthread_attr_t *attr)
+void uthread_attr_destroy(uthread_attr_t *attr)
 {
-	checkpoint("k%d: u%d: entering uthread_attr_set_elapsed_cpu_time",
-	           kthread_current_kthread()->cpuid,
-	           kthread_current_kthread()->current_uthread->tid);
-	struct timeval now, elapsed;
-	while (gettimeofday(&now, NULL));
-	timeval_subtract(&elapsed, &now, &attr->timeslice_start);
-	timeval_add(&attr->execution_time,
-	            &attr->execution_time, &elapsed);
-	checkpoint("Execution time: %ld.%06ld s",
-	           attr->execution_time.tv_sec,
-	           attr->execution_time.tv_usec);
+	kthread_slab_free(attr);
 }
@@ -0,0 +1,244 @@
+/*
+ * test_timeline.c
+ *
+ * Checks the structures the CFS timeline can be built on (see
+ * ../gt_timeline.h) against a plain array of the keys they should hold:
+ * random inserts, with repeated keys, mixed with delete-mins, then draining
+ * what is left. The rb-tree is also checked with removals from anywhere and
+ * an in-order walk. Keys never go below the last one taken out, as in CFS,
+ * since the radix heap relies on it.
+ *
+ * usage: test_timeline   (exits 1 on the first mismatch)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gt_rbtree.h>
+#include <gt_pheap.h>
+#include <gt_radixheap.h>
+
+#define NODES 4096
+#define ROUNDS 60000
+/* keys are drawn from [last min, last min + KEY_RANGE) */
+#define KEY_RANGE 1000UL
+
+/* one pool of nodes serves every structure */
+typedef struct test_node {
+	gt_rb_node_t rb;
+	gt_ph_node_t ph;
+	gt_rh_node_t rh;
+	unsigned long key;
+	int in; /* in the structure under test */
+} test_node_t;
+
+#define entry(ptr, member) \
+	((test_node_t *) ((char *) (ptr) - offsetof(test_node_t, member)))
+
+/* a structure under test, behind the operations CFS uses */
+typedef struct timeline_ops {
+	const char *name;
+	void (*init)(void);
+	void (*insert)(test_node_t *node);
+	test_node_t *(*first)(void);
+	test_node_t *(*delete_min)(void);
+	int (*empty)(void);
+} timeline_ops_t;
+
+static gt_rb_tree_t rb_tree;
+static gt_pheap_t pheap;
+static gt_radixheap_t radixheap;
+
+static void rb_init(void) { gt_rb_init(&rb_tree); }
+static void rb_insert(test_node_t *node)
+{
+	node->rb.key = node->key;
+	gt_rb_insert(&rb_tree, &node->rb);
+}
+static test_node_t *rb_first(void)
+{
+	gt_rb_node_t *node = gt_rb_first(&rb_tree);
+	return node ? entry(node, rb) : NULL;
+}
+static test_node_t *rb_delete_min(void)
+{
+	gt_rb_node_t *node = gt_rb_delete_min(&rb_tree);
+	return node ? entry(node, rb) : NULL;
+}
+static int rb_empty(void) { return gt_rb_empty(&rb_tree); }
+
+static void ph_init(void) { gt_ph_init(&pheap); }
+static void ph_insert(test_node_t *node)
+{
+	node->ph.key = node->key;
+	gt_ph_insert(&pheap, &node->ph);
+}
+static test_node_t *ph_first(void)
+{
+	gt_ph_node_t *node = gt_ph_first(&pheap);
+	return node ? entry(node, ph) : NULL;
+}
+static test_node_t *ph_delete_min(void)
+{
+	gt_ph_node_t *node = gt_ph_delete_min(&pheap);
+	return node ? entry(node, ph) : NULL;
+}
+static int ph_empty(void) { return gt_ph_empty(&pheap); }
+
+static void rh_init(void) { gt_rh_init(&radixheap); }
+static void rh_insert(test_node_t *node)
+{
+	node->rh.key = node->key;
+	gt_rh_insert(&radixheap, &node->rh);
+}
+static test_node_t *rh_first(void)
+{
+	gt_rh_node_t *node = gt_rh_first(&radixheap);
+	return node ? entry(node, rh) : NULL;
+}
+static test_node_t *rh_delete_min(void)
+{
+	gt_rh_node_t *node = gt_rh_delete_min(&radixheap);
+	return node ? entry(node, rh) : NULL;
+}
+static int rh_empty(void) { return gt_rh_empty(&radixheap); }
+
+static const timeline_ops_t timelines[] = {
+	{ "rbtree", rb_init, rb_insert, rb_first, rb_delete_min, rb_empty },
+	{ "pairing", ph_init, ph_insert, ph_first, ph_delete_min, ph_empty },
+	{ "radix", rh_init, rh_insert, rh_first, rh_delete_min, rh_empty },
+};
+
+static test_node_t nodes[NODES];
+/* the reference is the pool itself: the nodes marked in, with their keys */
+static int count;
+static unsigned long last_min;
+
+static unsigned int seed;
+
+static unsigned long next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static void check(int ok, const char *name, const char *what)
+{
+	if (ok)
+		return;
+	fprintf(stderr, "%s: %s (%d nodes in)\n", name, what, count);
+	exit(1);
+}
+
+/* the smallest key of the nodes in, by looking at all of them */
+static unsigned long reference_min(void)
+{
+	unsigned long min = ~0UL;
+	for (int i = 0; i < NODES; i++)
+		if (nodes[i].in && nodes[i].key < min)
+			min = nodes[i].key;
+	return min;
+}
+
+/* takes the minimum out of the structure and checks it against the
+ * reference */
+static void take_min(const timeline_ops_t *ops)
+{
+	unsigned long min = reference_min();
+	test_node_t *first = ops->first();
+	check(first && first->in && first->key == min, ops->name,
+	      "first isn't a node with the smallest key");
+	test_node_t *node = ops->delete_min();
+	check(node && node->in && node->key == min, ops->name,
+	      "delete_min didn't take out a node with the smallest key");
+	node->in = 0;
+	count--;
+	last_min = min;
+}
+
+static void put_random(const timeline_ops_t *ops)
+{
+	test_node_t *node;
+	do
+		node = &nodes[next_rand() % NODES];
+	while (node->in);
+	node->key = last_min + next_rand() % KEY_RANGE;
+	node->in = 1;
+	count++;
+	ops->insert(node);
+}
+
+static void test_timeline(const timeline_ops_t *ops)
+{
+	for (int i = 0; i < NODES; i++)
+		nodes[i].in = 0;
+	count = 0;
+	last_min = 0;
+	seed = 1;
+	ops->init();
+	check(ops->empty() && !ops->first() && !ops->delete_min(), ops->name,
+	      "new structure isn't empty");
+
+	/* drift between mostly inserting and mostly taking out */
+	for (int round = 0; round < ROUNDS; round++) {
+		int fill = (round / (NODES / 2)) % 2 ? NODES / 8 : NODES - 1;
+		if (count < fill && (count == 0 || next_rand() % 4))
+			put_random(ops);
+		else
+			take_min(ops);
+		check(ops->empty() == (count == 0), ops->name,
+		      "empty disagrees with the reference");
+	}
+	while (count)
+		take_min(ops);
+	check(ops->empty() && !ops->delete_min(), ops->name,
+	      "not empty after taking out every node");
+	printf("%s: ok\n", ops->name);
+}
+
+/* removes nodes from anywhere in the tree, checking an in-order walk against
+ * the reference after each */
+static void test_rb_erase(void)
+{
+	const char *name = "rbtree erase";
+	for (int i = 0; i < NODES; i++)
+		nodes[i].in = 0;
+	count = 0;
+	last_min = 0;
+	seed = 2;
+	rb_init();
+	while (count < NODES / 2)
+		put_random(&timelines[0]);
+
+	while (count) {
+		test_node_t *node;
+		do
+			node = &nodes[next_rand() % NODES];
+		while (!node->in);
+		gt_rb_erase(&rb_tree, &node->rb);
+		node->in = 0;
+		count--;
+
+		int seen = 0;
+		unsigned long prev = 0;
+		for (gt_rb_node_t *rb = gt_rb_first(&rb_tree); rb;
+		     rb = gt_rb_next(rb), seen++) {
+			check(entry(rb, rb)->in, name, "walk met a removed node");
+			check(rb->key >= prev, name, "walk out of order");
+			prev = rb->key;
+		}
+		check(seen == count, name, "walk missed nodes");
+		check(!count || rb_first()->key == reference_min(), name,
+		      "first isn't a node with the smallest key");
+	}
+	check(gt_rb_empty(&rb_tree), name, "not empty after erasing all");
+	printf("%s: ok\n", name);
+}
+
+int main(void)
+{
+	for (unsigned i = 0; i < sizeof(timelines) / sizeof(*timelines); i++)
+		test_timeline(&timelines[i]);
+	test_rb_erase();
+	return 0;
+}